@@ -26,6 +26,9 @@ class LinearAnimation: public PositionalAnimation {
 public:
     LinearAnimation(Point3);
     ~LinearAnimation();
+
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
     FPoint3 dpos();
     Point3 shift_pos(Point3);
 
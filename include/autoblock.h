@@ -8,9 +8,14 @@ public:
     AutoBlock(GameObject* parent, RoomMap* room_map);
     virtual ~AutoBlock();
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
+    static const ModCode KIND = ModCode::AutoBlock;
+
     std::string name();
     ModCode mod_code();
-    void serialize(MapFileO& file);
+    void serialize(MapFileO& file, GameObjectArray&);
     static void deserialize(MapFileI&, RoomMap*, GameObject*);
 
     bool is_agent();
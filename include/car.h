@@ -11,9 +11,14 @@ public:
     Car(GameObject* parent, ColorCycle color_cycle);
     virtual ~Car();
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
+    static const ModCode KIND = ModCode::Car;
+
     std::string name();
     ModCode mod_code();
-    void serialize(MapFileO& file);
+    void serialize(MapFileO& file, GameObjectArray&);
     static void deserialize(MapFileI&, RoomMap*, GameObject*);
 
     void collect_sticky_links(RoomMap*, Sticky, std::vector<GameObject*>&);
@@ -1,17 +1,28 @@
 #ifndef COMMON_CONSTANTS_H
 #define COMMON_CONSTANTS_H
 
+#include <cstddef>
+
 #include "point.h"
 
 const int GLOBAL_WALL_ID = 1;
 
 const int MAX_COLOR_CYCLE = 5;
 
+// One more than the largest ModCode
+const int MOD_CODE_COUNT = 6;
+
 // NOTE: the order matters here, for serialization reasons!
 const Point3 DIRECTIONS[6] = {{-1,0,0}, {0,-1,0}, {1,0,0}, {0,1,0}, {0,0,1}, {0,0,-1}};
 const Point3 H_DIRECTIONS[4] = {{-1,0,0}, {0,-1,0}, {1,0,0}, {0,1,0}};
 
-const int MAX_ROOM_DIMS = 255;
+// Layers with at least this many cells are stored as ChunkedMapLayers
+const int CHUNKED_LAYER_MIN_AREA = 4096;
+
+// A dense layer becomes sparse once fewer than 1/16 of its cells are occupied,
+// and only goes back once more than 1/8 are, so layers near the line don't thrash
+const int SPARSE_LAYER_ENTER_RATIO = 16;
+const int SPARSE_LAYER_EXIT_RATIO = 8;
 
 #define SOKOBAN_LARGE_WINDOW
 #ifdef SOKOBAN_LARGE_WINDOW
@@ -47,6 +58,15 @@ const int UNDO_COOLDOWN_FINAL = 2;
 
 const int MAX_UNDO_DEPTH = 1000;
 
+// How many bytes of rooms (see RoomManager) PlayingState keeps loaded
+const std::size_t ROOM_RESIDENCY_BUDGET = 1 << 24;
+// How many objects of a room RoomManager builds per frame
+const unsigned int ROOM_BUILD_SLICE = 256;
+
+// Each Slab chunk holds twice as many objects as the last, up to a limit
+const unsigned int SLAB_FIRST_CHUNK = 64;
+const unsigned int SLAB_MAX_CHUNK = 1 << 14;
+
 const int FAST_MAP_MOVE = 10;
 
 #endif // COMMON_CONSTANTS_H
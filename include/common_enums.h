@@ -2,7 +2,7 @@
 #define COMMON_ENUMS_H
 
 enum class MapCode {
-    Dimensions = 1, // The dimensions of the room as 1 byte integers
+    Dimensions = 1, // The dimensions of the room, as coordinates
     FullLayer = 2, // Create a new full layer
     SparseLayer = 3, // Create a new sparse layer
     DefaultPos = 4, // Mark the position to start the player at when loading from this map (only useful for testing, or a select few rooms)
@@ -12,9 +12,12 @@ enum class MapCode {
     SnakeLink = 8, // Link two snakes (1 = Right, 2 = Down)
     DoorDest = 9, // Give a door a destination Map + Pos
     Signaler = 10, // List of Switches and Switchables linked to a Signaler
-    Walls = 11, // List of positions of walls
+    Walls = 11, // List of positions of walls (superseded by WallRuns)
     PlayerData = 12, // Like Walls, the Player is listed separately from other objects
     GateBodyLocation = 13, // Indicates that a GateBody needs to be paired with its parent
+    ChunkedLayer = 14, // Create a new chunked layer
+    WallRuns = 15, // Runs of consecutive walls in each row
+    WideCoords = 16, // From here on, coordinates are 2 byte integers rather than 1 byte
     End = 255,
 };
 
@@ -3,16 +3,25 @@
 
 #include <vector>
 
+#include "point.h"
+
 class GameObject;
 class RoomMap;
 
 struct Component {
+    Component(bool falling);
     virtual ~Component();
+    // Detaches the component from its blocks and empties it for reuse
+    virtual void clear();
 
     std::vector<GameObject*> blocks_;
+    // Says which kind of Component this is, without RTTI
+    const bool falling_;
 };
 
 struct PushComponent: public Component {
+    PushComponent();
+    void clear();
     void add_pushing(Component* comp);
 
     std::vector<PushComponent*> pushing_;
@@ -21,12 +30,21 @@ struct PushComponent: public Component {
 };
 
 struct FallComponent: Component {
+    FallComponent();
+    void clear();
     void add_above(Component* comp);
 
     void settle_first();
     void take_falling(RoomMap* room_map);
+    void update_positions();
 
     std::vector<FallComponent*> above_;
+    // While falling, the blocks' positions only live here, parallel to
+    // blocks_, until update_positions writes them back
+    std::vector<Point3> positions_;
+    // How many layers the component falls before it lands,
+    // or before every block has left the bottom of the map
+    int drop_;
     bool settled_;
 };
 
@@ -1,11 +1,12 @@
 #ifndef DELTA_H
 #define DELTA_H
 
-#include <deque>
 #include <memory>
 #include <vector>
 
 #include "point.h"
+#include "gameobjectarray.h"
+#include "movearena.h"
 
 class Room;
 class RoomMap;
@@ -22,18 +23,32 @@ class GateBody;
 
 enum class RidingState;
 
+// Deltas refer to objects by handle rather than by pointer, so that they
+// don't pin down where objects live; they're resolved against the
+// GameObjectArray when the delta is reverted.  A modifier is referred to
+// by the handle of its parent.
 class Delta {
 public:
     virtual ~Delta();
-    virtual void revert() = 0;
+    virtual void revert(GameObjectArray&) = 0;
+    // Adds the maps in which revert changes what supports what; it's
+    // called before revert
+    virtual void collect_changed_maps(std::vector<RoomMap*>&);
 };
 
 
+// A frame and its list of deltas come from the slab and the scratch
+// buffers respectively, so recording a move reuses the storage of the
+// frames that dropped off the bottom of the undo stack
 class DeltaFrame {
 public:
     DeltaFrame();
     ~DeltaFrame();
-    void revert();
+
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
+    void revert(GameObjectArray&);
     void push(std::unique_ptr<Delta>);
     bool trivial();
 
@@ -41,24 +56,35 @@ public:
     bool changed();
 
 private:
-    std::vector<std::unique_ptr<Delta>> deltas_;
+    ScratchVector<std::unique_ptr<Delta>> deltas_;
     bool changed_;
 };
 
 
 class UndoStack {
 public:
-    UndoStack(unsigned int max_depth);
+    UndoStack(GameObjectArray& objs, unsigned int max_depth);
     ~UndoStack();
     void push(std::unique_ptr<DeltaFrame>);
     bool non_empty();
     void pop();
     void reset();
 
+    // Frames are numbered in the order they were pushed (with pops
+    // reusing numbers), so a frame's number never changes while it's
+    // on the stack.  Frames numbered below oldest_frame() are gone.
+    unsigned int oldest_frame();
+    unsigned int next_frame();
+
 private:
-    std::deque<std::unique_ptr<DeltaFrame>> frames_;
+    // A ring of max_depth_ slots, the oldest frame at first_, so that a
+    // full stack drops and adds frames without reallocating anything
+    std::vector<std::unique_ptr<DeltaFrame>> frames_;
+    GameObjectArray& objs_;
     unsigned int max_depth_;
+    unsigned int first_;
     unsigned int size_;
+    unsigned int dropped_;
 };
 
 
@@ -66,23 +92,31 @@ class CreationDelta: public Delta {
 public:
     CreationDelta(GameObject* obj, RoomMap* room_map);
     ~CreationDelta();
-    void revert();
+    void revert(GameObjectArray&);
+    void collect_changed_maps(std::vector<RoomMap*>&);
 
 private:
-    GameObject* obj_;
+    GameObjectHandle obj_;
     RoomMap* map_;
 };
 
 
+// Until it's reverted, this is the only thing keeping obj alive, so it
+// frees obj when it falls off the bottom of the undo stack.
 class DeletionDelta: public Delta {
 public:
-    DeletionDelta(GameObject* obj, RoomMap* room_map);
+    DeletionDelta(GameObject* obj, RoomMap* room_map, bool abstract);
     ~DeletionDelta();
-    void revert();
+    void revert(GameObjectArray&);
+    void collect_changed_maps(std::vector<RoomMap*>&);
 
 private:
-    GameObject* obj_;
+    GameObjectHandle obj_;
     RoomMap* map_;
+    // The map may be gone by the time this is, but the array never is
+    GameObjectArray& obj_array_;
+    bool abstract_;
+    bool reverted_;
 };
 
 
@@ -90,10 +124,10 @@ class AbstractCreationDelta: public Delta {
 public:
     AbstractCreationDelta(GameObject* obj, RoomMap* room_map);
     ~AbstractCreationDelta();
-    void revert();
+    void revert(GameObjectArray&);
 
 private:
-    GameObject* obj_;
+    GameObjectHandle obj_;
     RoomMap* map_;
 };
 
@@ -102,10 +136,11 @@ class PutDelta: public Delta {
 public:
     PutDelta(GameObject* obj, RoomMap* room_map);
     ~PutDelta();
-    void revert();
+    void revert(GameObjectArray&);
+    void collect_changed_maps(std::vector<RoomMap*>&);
 
 private:
-    GameObject* obj_;
+    GameObjectHandle obj_;
     RoomMap* map_;
 };
 
@@ -114,22 +149,28 @@ class TakeDelta: public Delta {
 public:
     TakeDelta(GameObject* obj, RoomMap* room_map);
     ~TakeDelta();
-    void revert();
+    void revert(GameObjectArray&);
+    void collect_changed_maps(std::vector<RoomMap*>&);
 
 private:
-    GameObject* obj_;
+    GameObjectHandle obj_;
     RoomMap* map_;
 };
 
 
+// The deltas that nearly every move records come from slabs
 class MotionDelta: public Delta {
 public:
     MotionDelta(GameObject* obj, Point3 dpos, RoomMap* room_map);
     ~MotionDelta();
-    void revert();
+    void revert(GameObjectArray&);
+    void collect_changed_maps(std::vector<RoomMap*>&);
+
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
 
 private:
-    GameObject* obj_;
+    GameObjectHandle obj_;
     Point3 dpos_;
     RoomMap* map_;
 };
@@ -137,12 +178,16 @@ private:
 
 class BatchMotionDelta: public Delta {
 public:
-    BatchMotionDelta(std::vector<GameObject*> objs, Point3 dpos, RoomMap* room_map);
+    BatchMotionDelta(const std::vector<GameObject*>& objs, Point3 dpos, RoomMap* room_map);
     ~BatchMotionDelta();
-    void revert();
+    void revert(GameObjectArray&);
+    void collect_changed_maps(std::vector<RoomMap*>&);
+
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
 
 private:
-    std::vector<GameObject*> objs_;
+    ScratchVector<GameObjectHandle> objs_;
     Point3 dpos_;
     RoomMap* map_;
 };
@@ -152,10 +197,10 @@ class AbstractMotionDelta: public Delta {
 public:
     AbstractMotionDelta(GameObject* obj, Point3 dpos);
     ~AbstractMotionDelta();
-    void revert();
+    void revert(GameObjectArray&);
 
 private:
-    GameObject* obj_;
+    GameObjectHandle obj_;
     Point3 dpos_;
 };
 
@@ -164,11 +209,14 @@ class AddLinkDelta: public Delta {
 public:
     AddLinkDelta(SnakeBlock* a, SnakeBlock* b);
     ~AddLinkDelta();
-    void revert();
+    void revert(GameObjectArray&);
+
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
 
 private:
-    SnakeBlock* a_;
-    SnakeBlock* b_;
+    GameObjectHandle a_;
+    GameObjectHandle b_;
 };
 
 
@@ -176,11 +224,14 @@ class RemoveLinkDelta: public Delta {
 public:
     RemoveLinkDelta(SnakeBlock* a, SnakeBlock* b);
     ~RemoveLinkDelta();
-    void revert();
+    void revert(GameObjectArray&);
+
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
 
 private:
-    SnakeBlock* a_;
-    SnakeBlock* b_;
+    GameObjectHandle a_;
+    GameObjectHandle b_;
 };
 
 
@@ -188,12 +239,13 @@ class DoorMoveDelta: public Delta {
 public:
     DoorMoveDelta(PlayingState* state, Room* room, std::vector<GameObject*>& objs);
     ~DoorMoveDelta();
-    void revert();
+    void revert(GameObjectArray&);
+    void collect_changed_maps(std::vector<RoomMap*>&);
 
 private:
     PlayingState* state_;
     Room* room_;
-    std::vector<std::pair<GameObject*, Point3>> pairs_;
+    std::vector<std::pair<GameObjectHandle, Point3>> pairs_;
 };
 
 
@@ -201,10 +253,10 @@ class SwitchableDelta: public Delta {
 public:
     SwitchableDelta(Switchable* obj, bool active, bool waiting);
     ~SwitchableDelta();
-    void revert();
+    void revert(GameObjectArray&);
 
 private:
-    Switchable* obj_;
+    GameObjectHandle obj_;
     bool active_;
     bool waiting_;
 };
@@ -214,20 +266,23 @@ class SwitchToggleDelta: public Delta {
 public:
     SwitchToggleDelta(Switch* obj);
     ~SwitchToggleDelta();
-    void revert();
+    void revert(GameObjectArray&);
 
 private:
-    Switch* obj_;
+    GameObjectHandle obj_;
 };
 
+// Signalers belong to their RoomMap rather than the GameObjectArray,
+// and keep their index in it during play, so this can hold that
 class SignalerToggleDelta: public Delta {
 public:
-    SignalerToggleDelta(Signaler*);
+    SignalerToggleDelta(Signaler*, RoomMap*);
     ~SignalerToggleDelta();
-    void revert();
+    void revert(GameObjectArray&);
 
 private:
-    Signaler* sig_;
+    RoomMap* map_;
+    int sig_index_;
 };
 
 
@@ -235,22 +290,24 @@ class RidingStateDelta: public Delta {
 public:
     RidingStateDelta(Player* player, RidingState state);
     ~RidingStateDelta();
-    void revert();
+    void revert(GameObjectArray&);
 
 private:
-    Player* player_;
+    GameObjectHandle player_;
     RidingState state_;
 };
 
 
 class ColorChangeDelta: public Delta {
 public:
-    ColorChangeDelta(Car* car, bool undo);
+    ColorChangeDelta(Car* car, RoomMap* room_map, bool undo);
     ~ColorChangeDelta();
-    void revert();
+    void revert(GameObjectArray&);
+    void collect_changed_maps(std::vector<RoomMap*>&);
 
 private:
-    Car* car_;
+    GameObjectHandle car_;
+    RoomMap* map_;
     bool undo_;
 };
 
@@ -258,10 +315,10 @@ class GatePosDelta: public Delta {
 public:
     GatePosDelta(GateBody* gate_body, Point3 dpos);
     ~GatePosDelta();
-    void revert();
+    void revert(GameObjectArray&);
 
 private:
-    GateBody* gate_body_;
+    GameObjectHandle gate_body_;
     Point3 dpos_;
 };
 
@@ -0,0 +1,58 @@
+#ifndef DIRTYTRACKER_H
+#define DIRTYTRACKER_H
+
+#include <vector>
+
+#include "point.h"
+
+// Everything that changed in a room since a subscriber last drained
+struct DirtyRegion {
+    // Cells in the order they were marked (possibly with repeats)
+    std::vector<Point3> cells;
+    // The bounding box of cells, inclusive at both ends
+    Point3 min;
+    Point3 max;
+    // If set, cells is meaningless and the whole room must be treated as changed
+    bool everything;
+
+    bool empty();
+};
+
+// Records which cells of a RoomMap have changed, for any number of
+// consumers that each want to catch up at their own pace.
+// Every mark advances the generation; a subscriber remembers the
+// generation it last drained at, and the log is trimmed to whatever
+// the slowest subscriber hasn't seen yet.
+class DirtyTracker {
+public:
+    DirtyTracker();
+    ~DirtyTracker();
+
+    int subscribe();
+    void unsubscribe(int sub);
+
+    void mark(Point3 pos);
+    void mark_everything();
+
+    unsigned int generation();
+    DirtyRegion drain(int sub);
+
+    // A subscriber which falls this far behind just gets told "everything"
+    static const unsigned int MAX_LOG_SIZE = 1 << 16;
+
+private:
+    struct Subscriber {
+        bool active;
+        unsigned int generation;
+    };
+
+    void trim();
+
+    std::vector<Point3> log_;
+    // The generation of log_[0]; subscribers from before it have missed something
+    unsigned int log_start_;
+    std::vector<Subscriber> subscribers_;
+    int active_count_;
+};
+
+#endif // DIRTYTRACKER_H
@@ -23,11 +23,16 @@ class Door: public Switchable {
 public:
     Door(GameObject* parent, bool def, bool active);
     virtual ~Door();
+
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
+    static const ModCode KIND = ModCode::Door;
     Door(const Door&);
 
     std::string name();
     ModCode mod_code();
-    void serialize(MapFileO& file);
+    void serialize(MapFileO& file, GameObjectArray&);
     static void deserialize(MapFileI&, RoomMap*, GameObject*);
 
     bool relation_check();
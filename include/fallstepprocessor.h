@@ -2,9 +2,10 @@
 #define FALLSTEPPROCESSOR_H
 
 #include <memory>
-#include <unordered_set>
+#include <utility>
 
 #include "component.h"
+#include "movearena.h"
 
 class RoomMap;
 class DeltaFrame;
@@ -12,21 +13,32 @@ class SnakeBlock;
 
 class FallStepProcessor {
 public:
-    FallStepProcessor(RoomMap*, DeltaFrame*, std::vector<GameObject*>&&);
+    FallStepProcessor(RoomMap*, DeltaFrame*, std::vector<GameObject*>&);
     ~FallStepProcessor();
 
     bool run();
     void check_land_first(FallComponent* comp);
     void collect_above(FallComponent* comp, std::vector<GameObject*>& above_list);
-    bool drop_check(FallComponent* comp);
-    void check_land_sticky(FallComponent* comp);
+    void find_drop(FallComponent* comp);
+    void recheck_near(FallComponent* landed);
+    bool lands(FallComponent* comp);
     void handle_fallen_blocks(FallComponent* comp);
     void settle(FallComponent* comp);
 
 private:
-    std::vector<std::unique_ptr<FallComponent>> fall_comps_unique_;
-    std::vector<GameObject*> fall_check_;
-    std::unordered_set<SnakeBlock*> snake_check_;
+    int column_key(Point3 pos);
+
+    // Where this processor's FallComponents start in the pool
+    unsigned int comp_mark_;
+    ScratchVector<FallComponent*> fall_comps_;
+    ScratchVector<GameObject*> fall_check_;
+    ScratchVector<SnakeBlock*> snake_check_;
+    // (drop, index in fall_comps_), as a min-heap; stale entries are skipped
+    ScratchVector<std::pair<int, int>> drop_queue_;
+    // (column, index in fall_comps_) for every falling block, sorted
+    ScratchVector<std::pair<int, int>> comp_columns_;
+    // Components which have put blocks back in the map since the last recheck
+    ScratchVector<FallComponent*> landed_;
     RoomMap* map_;
     DeltaFrame* delta_frame_;
     int layers_fallen_;
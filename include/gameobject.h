@@ -19,6 +19,7 @@
 
 #include "common_enums.h"
 #include "point.h"
+#include "gameobjectarray.h"
 
 class ObjectModifier;
 class PositionalAnimation;
@@ -45,10 +46,12 @@ public:
     virtual bool skip_serialization();
     virtual void serialize(MapFileO& file) = 0;
     virtual bool relation_check();
-    virtual void relation_serialize(MapFileO& file);
+    virtual void relation_serialize(MapFileO& file, GameObjectArray&);
 
     virtual bool is_agent();
 
+    GameObjectHandle handle();
+
     Point3 shifted_pos(Point3 d);
     void shift_internal_pos(Point3 d);
     void abstract_shift(Point3 dpos, DeltaFrame* delta_frame);
@@ -56,9 +59,6 @@ public:
     virtual void draw(GraphicsManager*) = 0;
     void draw_force_indicators(GraphicsManager*, glm::mat4& model);
 
-    virtual void setup_on_put(RoomMap*);
-    virtual void cleanup_on_take(RoomMap*);
-
     virtual void setup_on_undestruction(RoomMap*);
     virtual void cleanup_on_destruction(RoomMap*);
 
@@ -85,14 +85,32 @@ public:
     Component* comp_;
     Point3 pos_;
     int id_;
+    // The generation of id_'s slot when this was put in it
+    unsigned int gen_;
     int color_;
     bool pushable_;
     bool gravitable_;
 
     bool tangible_;
 
+    // Positions in the RoomMap's agent and gravitable indices
+    int agent_slot_;
+    int gravitable_slot_;
+
+    // The concrete type, for telling objects apart without RTTI
+    const ObjCode kind_;
+
 protected:
-    GameObject(Point3 pos, int color, bool pushable, bool gravitable);
+    GameObject(ObjCode kind, Point3 pos, int color, bool pushable, bool gravitable);
 };
 
+// A stand-in for dynamic_cast to a leaf class T, which declares its ObjCode as T::KIND
+template <typename T>
+T* kind_cast(GameObject* obj) {
+    if (obj && obj->kind_ == T::KIND) {
+        return static_cast<T*>(obj);
+    }
+    return nullptr;
+}
+
 #endif // GAMEOBJECT_H
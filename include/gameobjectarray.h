@@ -1,11 +1,33 @@
 #ifndef GAMEOBJECTARRAY_H
 #define GAMEOBJECTARRAY_H
 
+#include <functional>
 #include <memory>
+#include <queue>
 #include <vector>
 
 class GameObject;
 
+// Refers to an object by id, but can tell when that object has been
+// freed (and its id possibly given to a newer object).
+// Undo deltas hold these, so that they can outlive what they refer to,
+// and so do the links between objects (snake links, a Gate and its
+// GateBody, a Signaler's switches and switchables); a modifier is
+// referred to by the handle of its parent.
+// The default handle refers to nothing, and always resolves to nullptr.
+struct GameObjectHandle {
+    int id;
+    unsigned int gen;
+};
+
+inline bool operator==(GameObjectHandle a, GameObjectHandle b) {
+    return a.id == b.id && a.gen == b.gen;
+}
+
+inline bool operator!=(GameObjectHandle a, GameObjectHandle b) {
+    return !(a == b);
+}
+
 class GameObjectArray
 {
 public:
@@ -16,8 +38,18 @@ public:
     GameObject* safe_get(int id) const;
     void destroy(GameObject* obj);
 
+    // Returns nullptr if the handle's object has been freed
+    GameObject* get(GameObjectHandle) const;
+
+    // The number of slots, live or free
+    unsigned int size() const;
+
 private:
     std::vector<std::unique_ptr<GameObject>> array_;
+    // Bumped whenever a slot is freed, so old handles to it go stale
+    std::vector<unsigned int> generations_;
+    // Freed ids, smallest first, so the array stays as compact as possible
+    std::priority_queue<int, std::vector<int>, std::greater<int>> free_ids_;
 };
 
 #endif // GAMEOBJECTARRAY_H
@@ -2,6 +2,7 @@
 #define GATE_H
 
 #include "switchable.h"
+#include "gameobjectarray.h"
 
 
 class GateBody;
@@ -10,15 +11,20 @@ class MapFileO;
 
 class Gate: public Switchable {
 public:
-    Gate(GameObject* parent, GateBody* body, int color, bool def, bool active, bool waiting);
+    Gate(GameObject* parent, int color, bool def, bool active, bool waiting);
     virtual ~Gate();
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
+    static const ModCode KIND = ModCode::Gate;
+
     std::string name();
     ModCode mod_code();
-    void serialize(MapFileO& file);
+    void serialize(MapFileO& file, GameObjectArray&);
     static void deserialize(MapFileI&, RoomMap*, GameObject*);
 
-    void shift_internal_pos(Point3 d);
+    void shift_internal_pos(RoomMap*, Point3 d);
 
     void map_callback(RoomMap*, DeltaFrame*, MoveProcessor*);
     void collect_sticky_links(RoomMap*, Sticky, std::vector<GameObject*>&);
@@ -28,6 +34,8 @@ public:
 
     void setup_on_put(RoomMap*);
     void cleanup_on_take(RoomMap*);
+    void cleanup_on_destruction(RoomMap*);
+    void setup_on_undestruction(RoomMap*);
 
     void draw(GraphicsManager*, FPoint3);
 
@@ -36,9 +44,13 @@ public:
     int color_;
 
 private:
-    GateBody* body_;
+    GateBody* body(RoomMap*);
+
+    // Empty once the body is destroyed
+    GameObjectHandle body_;
 
     friend class ModifierTab;
+    friend class GateBody;
 };
 
 #endif // GATE_H
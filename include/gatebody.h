@@ -16,6 +16,9 @@ public:
     GateBody(const GateBody&);
     ~GateBody();
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
     std::string name();
     ObjCode obj_code();
     void serialize(MapFileO& file);
@@ -24,24 +27,31 @@ public:
 
     Point3 gate_pos();
     void set_gate(Gate*);
-    Point3 update_gate_pos(DeltaFrame*);
+    Point3 update_gate_pos(Gate*, DeltaFrame*);
 
     void collect_special_links(RoomMap*, Sticky, std::vector<GameObject*>&);
 
-    void set_gate_transition_animation(bool state, MoveProcessor*);
+    void cleanup_on_destruction(RoomMap*);
+    void setup_on_undestruction(RoomMap*);
+
+    void set_gate_transition_animation(bool state, RoomMap*, MoveProcessor*);
     bool update_state_animation();
     void reset_state_animation();
     bool state_animation();
 
     void draw(GraphicsManager*);
 
+    static const ObjCode KIND = ObjCode::GateBody;
+
 private:
-    Gate* gate_;
+    // The handle of the Gate's parent; empty once the Gate is destroyed
+    GameObjectHandle gate_;
     Point3 gate_pos_;
 
     std::unique_ptr<GateTransitionAnimation> transition_animation_;
 
     friend class GatePosDelta;
+    friend class Gate;
 };
 
 #endif // GATEBODY_H
@@ -7,6 +7,7 @@
 #include "point.h"
 
 #include "component.h"
+#include "movearena.h"
 
 class GameObject;
 class SnakeBlock;
@@ -30,13 +31,15 @@ private:
 
     bool compute_push_component_tree(GameObject* block);
     bool compute_push_component(GameObject* block);
+    bool push_straight_run(GameObject* first, std::vector<PushComponent*>& run);
 
     void collect_moving_and_weak_links(PushComponent* comp, std::vector<GameObject*>& weak_links);
 
-    std::vector<std::unique_ptr<PushComponent>> push_comps_unique_;
+    // Where this processor's PushComponents start in the pool
+    unsigned int comp_mark_;
 
-    std::vector<SnakeBlock*> moving_snakes_;
-    std::vector<SnakeBlock*> snakes_to_recheck_;
+    ScratchVector<SnakeBlock*> moving_snakes_;
+    ScratchVector<SnakeBlock*> snakes_to_recheck_;
     std::vector<GameObject*>& moving_blocks_;
     std::vector<GameObject*>& fall_check_;
 
@@ -2,6 +2,7 @@
 #define MAPFILE_H
 
 #include <fstream>
+#include <iostream>
 #include <string>
 
 #include "point.h"
@@ -18,15 +19,25 @@ enum class RidingState;
 class MapFileI {
 public:
     MapFileI(const std::string& path);
+    // Read from some other stream, e.g. a room snapshot kept in memory
+    MapFileI(std::istream& stream);
     ~MapFileI();
     void read(unsigned char* b, int n);
 
     unsigned char read_byte();
+    // A coordinate or a dimension of the room, 1 or 2 bytes depending on the file
+    int read_coord();
     Point3 read_point3();
     std::string read_str();
 
+    // For MapCode::WideCoords
+    void use_wide_coords();
+
 private:
     std::ifstream file_;
+    std::istream& stream_;
+    // Older files store each coordinate in a single byte
+    bool wide_coords_;
 };
 
 MapFileI& operator>>(MapFileI& f, int& v);
@@ -44,6 +55,7 @@ MapFileI& operator>>(MapFileI& f, ColorCycle& v);
 class MapFileO {
 public:
     MapFileO(const std::string& path);
+    MapFileO(std::ostream& stream);
     ~MapFileO();
 
     MapFileO& operator<<(unsigned char);
@@ -67,8 +79,13 @@ public:
     MapFileO& operator<<(Sticky);
     MapFileO& operator<<(RidingState);
 
+    // Coordinates are always written as 2 byte integers, so every file
+    // written starts with MapCode::WideCoords
+    void write_coord(int);
+
 private:
     std::ofstream file_;
+    std::ostream& stream_;
 };
 
 #endif // MAPFILE_H
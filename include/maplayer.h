@@ -1,9 +1,11 @@
 #ifndef MAPLAYER_H
 #define MAPLAYER_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <vector>
-#include <unordered_map>
 
 #include "common_enums.h"
 #include "point.h"
@@ -23,22 +25,53 @@ struct MapRect {
     bool contains(Point2);
 };
 
-using GameObjIDFunc = std::function<void(int)>;
+// Dense layers keep one bit per cell marking whether it's occupied,
+// so that scans can skip over empty space a whole word at a time
+typedef uint64_t OccupancyWord;
+const int OCCUPANCY_WORD_BITS = 64;
+
+// The bits [lo, hi) of a word, where 0 <= lo < hi <= OCCUPANCY_WORD_BITS
+inline OccupancyWord occupancy_mask(int lo, int hi) {
+    OccupancyWord ones = (hi - lo == OCCUPANCY_WORD_BITS) ? ~OccupancyWord{0} : (OccupancyWord{1} << (hi - lo)) - 1;
+    return ones << lo;
+}
+
+// Calls f(b) for each set bit b of word & mask, in increasing order.
+// The word is reread after every call, so f is allowed to modify it.
+template <typename F>
+inline void for_each_occupied_bit(const OccupancyWord& word, OccupancyWord mask, F f) {
+    OccupancyWord bits = word & mask;
+    while (bits) {
+        int b = __builtin_ctzll(bits);
+        f(b);
+        bits = word & mask & (~OccupancyWord{1} << b);
+    }
+}
 
 class MapLayer {
 public:
     MapLayer(RoomMap*);
     virtual ~MapLayer() = 0;
 
-    virtual int& at(Point2 pos) = 0;
+    virtual int at(Point2 pos) = 0;
+    virtual void set(Point2 pos, int id) = 0;
     virtual MapCode type() = 0;
+    // The number of nonempty cells
+    int count();
+    // The bytes this layer takes up, including what it has allocated
+    virtual std::size_t memory_usage() = 0;
 
-    virtual void apply_to_rect(MapRect, GameObjIDFunc&) = 0;
+    // Each concrete layer also has a member template
+    // for_each_in_rect(MapRect, F& f), which calls f(id) for every
+    // nonzero id in the rect.  f is allowed to take objects out of the map.
+    // RoomMap::for_each_in_rect picks the right one for each layer.
+    virtual void copy_into(MapLayer&) = 0;
     virtual void extend_by(int dx, int dy) = 0;
     virtual void shift_by(int dx, int dy) = 0;
 
 protected:
     RoomMap* parent_map_;
+    int count_;
 };
 
 class FullMapLayer: public MapLayer {
@@ -46,17 +79,28 @@ public:
     FullMapLayer(RoomMap*, int width, int height);
     ~FullMapLayer();
 
-    int& at(Point2 pos);
+    int at(Point2 pos);
+    void set(Point2 pos, int id);
     MapCode type();
+    std::size_t memory_usage();
 
-    void apply_to_rect(MapRect, GameObjIDFunc&);
+    template <typename F>
+    void for_each_in_rect(MapRect, F& f);
+    void copy_into(MapLayer&);
     void extend_by(int dx, int dy);
     void shift_by(int dx, int dy);
 
 private:
-    std::vector<std::vector<int>> map_;
+    void relayout(int width, int height, int dx, int dy);
+    OccupancyWord& occupancy_word(int x, int y);
+
+    // Cells are stored contiguously, row by row (x varies fastest)
+    std::vector<int> map_;
+    // Each row of the occupancy bitmap starts on a fresh word
+    std::vector<OccupancyWord> occupied_;
     int width_;
     int height_;
+    int row_words_;
 };
 
 
@@ -65,15 +109,235 @@ public:
     SparseMapLayer(RoomMap*);
     ~SparseMapLayer();
 
-    int& at(Point2 pos);
+    int at(Point2 pos);
+    void set(Point2 pos, int id);
+    MapCode type();
+    std::size_t memory_usage();
+
+    template <typename F>
+    void for_each_in_rect(MapRect, F& f);
+    void copy_into(MapLayer&);
+    void extend_by(int dx, int dy);
+    void shift_by(int dx, int dy);
+
+private:
+    void collect_ids(MapRect, std::vector<int>& ids);
+
+    // An open addressing (linear probing) table entry, keyed on a packed position
+    struct Slot {
+        unsigned int key;
+        int id;
+    };
+
+    static const unsigned int EMPTY_KEY = 0xffffffff;
+    static const int MIN_CAPACITY = 16;
+
+    static unsigned int pack(Point2 pos);
+    static Point2 unpack(unsigned int key);
+    unsigned int home_slot(unsigned int key);
+
+    int find(unsigned int key);
+    void insert(unsigned int key, int id);
+    void erase(int i);
+    void rehash(int capacity);
+    void rebuild(int dx, int dy);
+
+    void add_to_row(Point2 pos);
+    void remove_from_row(Point2 pos);
+
+    std::vector<Slot> slots_;
+    // For each row y, the x coordinates of its nonempty cells
+    std::vector<std::vector<int>> rows_;
+};
+
+
+// A MapLayer made of fixed size square chunks, which are only
+// allocated once something is put in them, and freed when emptied.
+class ChunkedMapLayer: public MapLayer {
+public:
+    ChunkedMapLayer(RoomMap*, int width, int height);
+    ~ChunkedMapLayer();
+
+    int at(Point2 pos);
+    void set(Point2 pos, int id);
     MapCode type();
+    std::size_t memory_usage();
 
-    void apply_to_rect(MapRect, GameObjIDFunc&);
+    template <typename F>
+    void for_each_in_rect(MapRect, F& f);
+    void copy_into(MapLayer&);
     void extend_by(int dx, int dy);
     void shift_by(int dx, int dy);
 
+    static const int CHUNK_BITS = 4;
+    static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+    static const int CHUNK_MASK = CHUNK_SIZE - 1;
+
 private:
-    std::unordered_map<Point2, int, Point2Hash> map_;
+    static const int CHUNK_WORDS = CHUNK_SIZE*CHUNK_SIZE / OCCUPANCY_WORD_BITS;
+
+    struct Chunk {
+        int cells[CHUNK_SIZE*CHUNK_SIZE];
+        // Bit k is set iff cells[k] is nonzero
+        OccupancyWord occupied[CHUNK_WORDS];
+        int count; // Number of nonzero cells
+    };
+
+    int chunk_index(Point2 pos);
+    void release_chunk(int k);
+    void release_empty_chunks(int cx0, int cx1, int cy0, int cy1);
+    void relayout(int width, int height, int dx, int dy);
+
+    // The chunk directory itself is only allocated once the layer is nonempty
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    int width_;
+    int height_;
+    int chunks_w_;
+    int chunks_h_;
+    int live_chunks_;
+    // Chunks may not be freed while for_each_in_rect is walking them
+    bool iterating_;
 };
 
+
+// One bit per cell across all z levels of a room.  This is how walls
+// are stored, since they carry no state, and how RoomMap marks which
+// cells have listeners.
+class BitLayer {
+public:
+    BitLayer(int width, int height, int depth);
+    ~BitLayer();
+
+    bool at(Point3 pos);
+    void set(Point3 pos, bool bit);
+    // Set the bits of the cells from start to start + (length-1, 0, 0)
+    void fill_run(Point3 start, int length);
+
+    // Each row is written as runs of consecutive set bits
+    void serialize(MapFileO& file);
+
+    std::size_t memory_usage();
+
+    void extend_by(Point3 d);
+    void shift_by(Point3 d);
+
+private:
+    void relayout(int width, int height, int depth, Point3 d);
+    OccupancyWord* row(int y, int z);
+    int next_run_boundary(OccupancyWord* row, int x, bool bit);
+
+    std::vector<OccupancyWord> bits_;
+    int width_;
+    int height_;
+    int depth_;
+    int row_words_;
+};
+
+
+// Also one bit per occupied cell, but laid out column by column, so that
+// the nearest occupied cell below a point takes a word or two to find
+// no matter how tall the room is.  RoomMap keeps this in step with its
+// layers and walls, for working out how far things fall.
+class ColumnIndex {
+public:
+    ColumnIndex(int width, int height, int depth);
+    ~ColumnIndex();
+
+    bool at(Point3 pos);
+    void set(Point3 pos, bool bit);
+    // The highest occupied z' < pos.z in pos's column, or -1 if there isn't one
+    int highest_below(Point3 pos);
+
+    std::size_t memory_usage();
+
+    void extend_by(Point3 d);
+    void shift_by(Point3 d);
+
+private:
+    void relayout(int width, int height, int depth, Point3 d);
+    OccupancyWord* column(int x, int y);
+
+    std::vector<OccupancyWord> bits_;
+    int width_;
+    int height_;
+    int depth_;
+    int column_words_;
+};
+
+
+// Only the occupied cells are visited, found by scanning the bitmap
+template <typename F>
+void FullMapLayer::for_each_in_rect(MapRect rect, F& f) {
+    if (!count_ || rect.w <= 0 || rect.h <= 0) {
+        return;
+    }
+    int x_end = rect.x + rect.w;
+    int w0 = rect.x / OCCUPANCY_WORD_BITS;
+    int w1 = (x_end - 1) / OCCUPANCY_WORD_BITS;
+    for (int j = rect.y; j < rect.y + rect.h; ++j) {
+        for (int w = w0; w <= w1; ++w) {
+            int base = w*OCCUPANCY_WORD_BITS;
+            OccupancyWord mask = occupancy_mask(std::max(rect.x - base, 0),
+                                                std::min(x_end - base, OCCUPANCY_WORD_BITS));
+            for_each_occupied_bit(occupied_[row_words_*j + w], mask, [&](int b) {
+                f(map_[base + b + width_*j]);
+            });
+        }
+    }
+}
+
+template <typename F>
+void SparseMapLayer::for_each_in_rect(MapRect rect, F& f) {
+    if (!count_) {
+        return;
+    }
+    // f may take objects out of the map, which would modify the rows
+    std::vector<int> ids {};
+    collect_ids(rect, ids);
+    for (int id : ids) {
+        f(id);
+    }
+}
+
+template <typename F>
+void ChunkedMapLayer::for_each_in_rect(MapRect rect, F& f) {
+    if (chunks_.empty() || rect.w <= 0 || rect.h <= 0) {
+        return;
+    }
+    bool was_iterating = iterating_;
+    iterating_ = true;
+    int x_end = rect.x + rect.w;
+    int y_end = rect.y + rect.h;
+    int cx0 = rect.x >> CHUNK_BITS;
+    int cx1 = (x_end - 1) >> CHUNK_BITS;
+    int cy0 = rect.y >> CHUNK_BITS;
+    int cy1 = (y_end - 1) >> CHUNK_BITS;
+    for (int cy = cy0; cy <= cy1; ++cy) {
+        for (int cx = cx0; cx <= cx1; ++cx) {
+            Chunk* chunk = chunks_[cx + chunks_w_*cy].get();
+            if (!chunk) {
+                continue;
+            }
+            int j0 = std::max(rect.y - (cy << CHUNK_BITS), 0);
+            int j1 = std::min(y_end - (cy << CHUNK_BITS), CHUNK_SIZE);
+            int i0 = std::max(rect.x - (cx << CHUNK_BITS), 0);
+            int i1 = std::min(x_end - (cx << CHUNK_BITS), CHUNK_SIZE);
+            // Several rows of a chunk share each bitmap word
+            for (int j = j0; j < j1 && chunk->count; ++j) {
+                int k_row = j << CHUNK_BITS;
+                int base = k_row - k_row % OCCUPANCY_WORD_BITS;
+                int lo = k_row % OCCUPANCY_WORD_BITS;
+                for_each_occupied_bit(chunk->occupied[k_row / OCCUPANCY_WORD_BITS],
+                                      occupancy_mask(lo + i0, lo + i1), [&](int b) {
+                    f(chunk->cells[base + b]);
+                });
+            }
+        }
+    }
+    iterating_ = was_iterating;
+    if (!iterating_) {
+        release_empty_chunks(cx0, cx1, cy0, cy1);
+    }
+}
+
 #endif // MAPLAYER_H
@@ -0,0 +1,91 @@
+#ifndef MOVEARENA_H
+#define MOVEARENA_H
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Storage for the short-lived things a move builds (components, worklists),
+// kept from one move to the next, so that once a room has been played in
+// for a bit, moving in it doesn't need the heap at all.
+
+// Spare buffers for ScratchVector<T>, most recently returned first
+template <typename T>
+std::vector<std::vector<T>>& scratch_buffers() {
+    static std::vector<std::vector<T>> buffers {};
+    return buffers;
+}
+
+// A vector which borrows its buffer from the arena when it's made, and
+// gives it back (emptied, but with its capacity) when it goes away.
+// Swap rather than move-assign between these, or a buffer gets freed.
+template <typename T>
+class ScratchVector: public std::vector<T> {
+public:
+    ScratchVector(): std::vector<T>() {
+        auto& buffers = scratch_buffers<T>();
+        if (!buffers.empty()) {
+            this->swap(buffers.back());
+            buffers.pop_back();
+        }
+    }
+
+    ~ScratchVector() {
+        this->clear();
+        scratch_buffers<T>().push_back(std::move(*this));
+    }
+
+    ScratchVector(const ScratchVector&) = delete;
+    ScratchVector& operator=(const ScratchVector&) = delete;
+
+    ScratchVector& operator=(const std::vector<T>& vec) {
+        this->assign(vec.begin(), vec.end());
+        return *this;
+    }
+};
+
+// For scratch lists used as small sets
+template <typename T>
+void push_unique(std::vector<T>& vec, const T& x) {
+    if (std::find(vec.begin(), vec.end(), x) == vec.end()) {
+        vec.push_back(x);
+    }
+}
+
+// Components of one kind, recycled from move to move.  A processor notes
+// mark() when it starts, acquire()s what it needs, and release()s back to
+// its mark when it's done, which clears those components for next time.
+template <typename T>
+class ComponentPool {
+public:
+    ComponentPool(): comps_ {}, used_ {0} {}
+
+    T* acquire() {
+        if (used_ == comps_.size()) {
+            comps_.push_back(std::make_unique<T>());
+        }
+        return comps_[used_++].get();
+    }
+
+    unsigned int mark() {
+        return used_;
+    }
+
+    void release(unsigned int mark) {
+        while (used_ > mark) {
+            comps_[--used_]->clear();
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<T>> comps_;
+    unsigned int used_;
+};
+
+template <typename T>
+ComponentPool<T>& component_pool() {
+    static ComponentPool<T> pool {};
+    return pool;
+}
+
+#endif // MOVEARENA_H
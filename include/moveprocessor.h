@@ -1,8 +1,11 @@
 #ifndef MOVEPROCESSOR_H
 #define MOVEPROCESSOR_H
 
+#include <cstddef>
 #include <vector>
 
+#include "movearena.h"
+
 class Player;
 class GameObject;
 class PlayingState;
@@ -27,6 +30,9 @@ public:
     MoveProcessor(PlayingState*, RoomMap*, DeltaFrame*, bool);
     ~MoveProcessor();
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
     bool try_move(Player*, Point3);
     void color_change(Player*);
 
@@ -48,10 +54,10 @@ private:
     void move_bound(Player*, Point3);
     void move_general(Point3);
 
-    std::vector<GameObject*> moving_blocks_;
-    std::vector<GameObject*> fall_check_;
+    ScratchVector<GameObject*> moving_blocks_;
+    ScratchVector<GameObject*> fall_check_;
 
-    std::vector<std::pair<GateBody*, bool>> gate_transitions_;
+    ScratchVector<std::pair<GateBody*, bool>> gate_transitions_;
 
     PlayingState* playing_state_;
     RoomMap* map_;
@@ -0,0 +1,63 @@
+#ifndef OBJECTINDEX_H
+#define OBJECTINDEX_H
+
+#include <vector>
+
+// A list of objects in the order they were added, which an object can be
+// removed from in constant time: each object keeps its position in the
+// list in one of its own members, and removal leaves a hole behind.
+// The holes are squeezed out (keeping the order) once they make up half
+// the list, so a run of removals costs constant time per removal.
+// Don't add or remove objects while going through the list.
+template <typename T>
+class ObjectIndex {
+public:
+    explicit ObjectIndex(int T::* slot): entries_ {}, slot_ {slot}, holes_ {0} {}
+
+    void push(T* obj) {
+        obj->*slot_ = entries_.size();
+        entries_.push_back(obj);
+    }
+
+    void erase(T* obj) {
+        entries_[obj->*slot_] = nullptr;
+        ++holes_;
+        if (2 * holes_ > entries_.size()) {
+            compact();
+        }
+    }
+
+    void clear() {
+        entries_.clear();
+        holes_ = 0;
+    }
+
+    // Calls f(obj) for every object in the list, in order
+    template <typename F>
+    void for_each(F f) const {
+        for (T* obj : entries_) {
+            if (obj) {
+                f(obj);
+            }
+        }
+    }
+
+private:
+    void compact() {
+        unsigned int live = 0;
+        for (T* obj : entries_) {
+            if (obj) {
+                obj->*slot_ = live;
+                entries_[live++] = obj;
+            }
+        }
+        entries_.resize(live);
+        holes_ = 0;
+    }
+
+    std::vector<T*> entries_;
+    int T::* slot_;
+    unsigned int holes_;
+};
+
+#endif // OBJECTINDEX_H
@@ -14,16 +14,18 @@ class MoveProcessor;
 class MapFileI;
 class MapFileO;
 class GraphicsManager;
+class GameObjectArray;
 
 // Base class of object modifiers such as Car, Door, Switch, and Gate
 class ObjectModifier {
 public:
-    ObjectModifier(GameObject* parent);
+    ObjectModifier(GameObject* parent, ModCode kind);
     virtual ~ObjectModifier();
+    ObjectModifier(const ObjectModifier&);
 
     virtual std::string name() = 0;
     virtual ModCode mod_code() = 0;
-    virtual void serialize(MapFileO& file) = 0;
+    virtual void serialize(MapFileO& file, GameObjectArray&) = 0;
     virtual bool relation_check();
     virtual void relation_serialize(MapFileO& file);
 
@@ -35,23 +37,42 @@ public:
 
     Point3 pos();
     Point3 shifted_pos(Point3 d);
-    virtual void shift_internal_pos(Point3 d);
     Point3 pos_above(); // A convenience function often needed by Modifiers
     int color();
     bool pushable();
     bool gravitable();
 
-    virtual void setup_on_put(RoomMap* room_map);
-    virtual void cleanup_on_take(RoomMap* room_map);
     virtual void cleanup_on_destruction(RoomMap* room_map);
     virtual void setup_on_undestruction(RoomMap* room_map);
 
     virtual std::unique_ptr<ObjectModifier> duplicate(GameObject*, RoomMap*, DeltaFrame*) = 0;
 
-    // Every type of Modifier can have at most one callback function for map listeners
-    virtual void map_callback(RoomMap*, DeltaFrame*, MoveProcessor*);
+    // The kinds which listen to the map (Door, PressSwitch and Gate) also have
+    // setup_on_put, cleanup_on_take and map_callback.  These aren't virtual:
+    // the RoomMap runs them a kind at a time, as the leaf class.
     virtual void collect_sticky_links(RoomMap*, Sticky, std::vector<GameObject*>&);
 
+    // The RoomMap listener generation this was last queued in
+    unsigned int activated_gen_;
+    // The RoomMap event generation this was last listed as moved in
+    unsigned int moved_gen_;
+    // The concrete type, for telling modifiers apart without RTTI
+    const ModCode kind_;
+
+    // Where this is registered as a listener, if anywhere
+    bool listening_;
+    Point3 listen_pos_;
+    // Position in the RoomMap's index of modifiers of this kind
+    int index_slot_;
 };
 
+// A stand-in for dynamic_cast to a leaf class T, which declares its ModCode as T::KIND
+template <typename T>
+T* kind_cast(ObjectModifier* mod) {
+    if (mod && mod->kind_ == T::KIND) {
+        return static_cast<T*>(mod);
+    }
+    return nullptr;
+}
+
 #endif // OBJECTMODIFIER_H
@@ -12,6 +12,9 @@ public:
     Player(Point3 pos, RidingState state);
     virtual ~Player();
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
     std::string name();
     ObjCode obj_code();
     bool skip_serialization();
@@ -27,6 +30,8 @@ public:
     void draw(GraphicsManager*);
 
     RidingState state_;
+
+    static const ObjCode KIND = ObjCode::Player;
 };
 
 #endif // PLAYER_H
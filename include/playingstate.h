@@ -11,6 +11,7 @@
 class GameObjectArray;
 class GraphicsManager;
 class Room;
+class RoomManager;
 class GameObject;
 class Player;
 class MoveProcessor;
@@ -36,10 +37,10 @@ public:
     bool can_use_door(Door*, std::vector<GameObject*>&, bool* same_room);
 
 private:
-    std::unordered_map<std::string, std::unique_ptr<Room>> loaded_rooms_;
     std::unique_ptr<GameObjectArray> objs_;
     std::unique_ptr<MoveProcessor> move_processor_;
     std::unique_ptr<UndoStack> undo_stack_;
+    std::unique_ptr<RoomManager> rooms_;
     std::unique_ptr<DeltaFrame> delta_frame_;
     Room* room_;
     Player* player_;
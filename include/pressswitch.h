@@ -16,9 +16,14 @@ public:
     PressSwitch(GameObject* parent, int color, bool persistent, bool active);
     virtual ~PressSwitch();
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
+    static const ModCode KIND = ModCode::PressSwitch;
+
     std::string name();
     ModCode mod_code();
-    void serialize(MapFileO& file);
+    void serialize(MapFileO& file, GameObjectArray&);
     static void deserialize(MapFileI&, RoomMap*, GameObject*);
 
     void map_callback(RoomMap*, DeltaFrame*, MoveProcessor*);
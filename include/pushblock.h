@@ -8,6 +8,9 @@ public:
     PushBlock(Point3 pos, int color, bool pushable, bool gravitable, Sticky sticky);
     virtual ~PushBlock();
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
     virtual std::string name();
     virtual ObjCode obj_code();
     virtual void serialize(MapFileO& file);
@@ -20,6 +23,9 @@ public:
     Sticky sticky();
 
     Sticky sticky_;
+
+protected:
+    PushBlock(ObjCode kind, Point3 pos, int color, bool pushable, bool gravitable, Sticky sticky);
 };
 
 #endif // PUSHBLOCK_H
@@ -26,6 +26,10 @@ public:
 
     void write_to_file(MapFileO& file, Point3 start_pos);
     void load_from_file(GameObjectArray& objs, MapFileI& file, Point3* start_pos=nullptr);
+    // Reads the file until max_objects objects have been made, so that a big
+    // room can be loaded a slice at a time by calling this again with the
+    // same file.  Returns true once the whole file has been read.
+    bool load_part(GameObjectArray& objs, MapFileI& file, unsigned int max_objects, Point3* start_pos=nullptr);
 
     void draw(GraphicsManager*, Point3 cam_pos, bool ortho, bool one_layer);
     void draw(GraphicsManager*, GameObject* target, bool ortho, bool one_layer);
@@ -39,17 +43,22 @@ private:
     std::unique_ptr<RoomMap> map_;
     std::unique_ptr<Camera> camera_;
 
+    // Where load_part left off
+    int loaded_layers_;
+    bool reading_objects_;
+
 public:
     Point3_S16 offset_pos_;
     // This is used exclusively for making sure doors between rooms stay accurate
 
 private:
-    void read_objects(MapFileI& file);
+    bool read_objects(MapFileI& file, unsigned int& max_objects);
     void read_camera_rects(MapFileI& file);
     void read_snake_link(MapFileI& file);
     void read_door_dest(MapFileI& file);
     void read_signaler(MapFileI& file);
     void read_walls(MapFileI& file);
+    void read_wall_runs(MapFileI& file);
     void read_player_data(MapFileI& file);
 };
 
@@ -0,0 +1,102 @@
+#ifndef ROOMMANAGER_H
+#define ROOMMANAGER_H
+
+#include <cstddef>
+#include <future>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class GameObjectArray;
+class UndoStack;
+class Room;
+class MapFileI;
+
+// Decides which of the PlayingState's rooms are resident in memory.
+// The door destinations of the active room are read from disk on a worker
+// thread ahead of time, and built a slice at a time between moves, so that
+// nothing in the middle of a move waits on a room.  When the resident rooms
+// exceed the budget, the least recently visited ones are evicted, leaving
+// behind a snapshot of their state to be rebuilt from when they're needed.
+class RoomManager {
+public:
+    // The budget is in bytes: RoomMap::memory_usage() and the file contents
+    // kept for each resident room, plus the snapshots of evicted ones
+    RoomManager(GameObjectArray& objs, UndoStack& undo_stack, std::size_t budget);
+    ~RoomManager();
+
+    // Returns nullptr if the room isn't resident yet (it's then read and
+    // built over the next few updates); this never waits on the disk
+    Room* get_room(const std::string& name);
+    // Builds the room right away if need be, which may stall
+    Room* load_room(const std::string& name);
+    // Call this whenever there's no move in progress
+    void update(Room* active_room);
+
+private:
+    struct ResidentRoom {
+        std::unique_ptr<Room> room;
+        std::list<std::string>::iterator lru_pos;
+        // Only undo frames numbered below this can refer to the room
+        unsigned int frames_end;
+        // What the room was built from, which still describes it as long
+        // as its map's dirty generation hasn't moved on from built_generation
+        std::string source;
+        unsigned int built_generation;
+        // What measure() found at measured_generation
+        std::size_t bytes;
+        unsigned int measured_generation;
+    };
+
+    // A room being built, ROOM_BUILD_SLICE objects per update
+    struct PendingBuild {
+        PendingBuild(const std::string& name, std::string bytes);
+        ~PendingBuild();
+
+        std::string name;
+        std::string bytes;
+        std::istringstream stream;
+        std::unique_ptr<MapFileI> file;
+        std::unique_ptr<Room> room;
+        bool loaded;
+    };
+
+    std::unique_ptr<Room> build_room(const std::string& name, const std::string& bytes);
+    void make_resident(const std::string& name, std::unique_ptr<Room> room, std::string bytes);
+    void touch(const std::string& name);
+    void prefetch(const std::string& name);
+    void prefetch_doors(Room* room);
+    bool take_ready_bytes(const std::string& name, std::string& bytes);
+    void start_build();
+    void advance_build();
+    std::size_t measure(ResidentRoom& resident);
+    void evict_over_budget(Room* active_room);
+    bool can_evict(const std::string& name, Room* active_room);
+    void evict(const std::string& name);
+
+    GameObjectArray& objs_;
+    UndoStack& undo_stack_;
+    std::size_t budget_;
+
+    std::unordered_map<std::string, ResidentRoom> rooms_;
+    // Most recently visited first
+    std::list<std::string> lru_;
+    // Raw .map file contents, still being read on a worker thread
+    std::unordered_map<std::string, std::future<std::string>> prefetches_;
+    // The serialized state of each evicted room
+    std::unordered_map<std::string, std::string> snapshots_;
+    std::size_t snapshot_bytes_;
+    std::unique_ptr<PendingBuild> build_;
+    // Rooms get_room was asked for and hasn't yet returned, which are built
+    // before anything else
+    std::vector<std::string> wanted_;
+
+    Room* active_room_;
+    // Evicting these would just waste the prefetch
+    std::vector<std::string> door_dests_;
+};
+
+#endif // ROOMMANAGER_H
@@ -4,14 +4,17 @@
 #include <memory>
 #include <vector>
 #include <unordered_map>
-#include <unordered_set>
 
 #include "point.h"
+#include "common_enums.h"
+#include "maplayer.h"
+#include "objectindex.h"
 
 class GameObjectArray;
 class Signaler;
 class Effects;
-class MapLayer;
+class DirtyTracker;
+class StickyCache;
 class GraphicsManager;
 class DeltaFrame;
 class MoveProcessor;
@@ -23,6 +26,27 @@ class RoomMap;
 
 typedef void(ObjectModifier::*MapCallback)(RoomMap*,DeltaFrame*);
 
+enum class MapEventType {
+    CellEntered,
+    CellVacated,
+};
+
+// Recorded as the map changes, and only acted on by flush_events
+struct MapEvent {
+    MapEventType type;
+    GameObject* obj;
+    Point3 pos;
+};
+
+// A cell whose contents changed, recorded for collect_fall_check
+struct SupportChange {
+    Point3 pos;
+    // The id of what arrived in the cell (or changed there), or 0 if something left
+    int entered_id;
+    // Whether the thing that left or changed could have held its neighbors up
+    bool sticky;
+};
+
 class RoomMap {
 public:
     RoomMap(GameObjectArray& objs, int width, int height, int depth);
@@ -31,11 +55,25 @@ public:
 
     //void print_listeners();
 
-    void push_full();
-    void push_sparse();
+    void set_layer_type(int z, MapCode type);
+    void update_layer_types();
+    // The bytes taken up by the layers, the per-cell bitmaps, the objects
+    // and the signalers
+    std::size_t memory_usage();
 
-    int& at(Point3);
+    int at(Point3);
+    void set(Point3, int id);
     GameObject* view(Point3);
+    int id_at(Point3);
+    // The z of the nearest occupied cell (object or wall) under pos, or -1
+    // if there's nothing there; pos must be horizontally inside the map
+    int highest_below(Point3);
+
+    // Calls f(id) for every object id in the rect, on every layer (or just layer z)
+    template <typename F>
+    void for_each_in_rect(MapRect rect, F&& f) const;
+    template <typename F>
+    void for_each_in_layer(int z, MapRect rect, F&& f) const;
 
     void just_take(GameObject*);
     void just_put(GameObject*);
@@ -47,19 +85,25 @@ public:
     void create(std::unique_ptr<GameObject>, DeltaFrame*);
     void create_abstract(std::unique_ptr<GameObject>, DeltaFrame*);
     void create_wall(Point3);
+    void create_wall_run(Point3 start, int length);
+    void remove_wall(Point3);
     void uncreate(GameObject*);
     void uncreate_abstract(GameObject*);
     void destroy(GameObject*, DeltaFrame*);
-    void undestroy(GameObject*);
+    void undestroy(GameObject*, bool abstract);
+    void set_modifier(GameObject*, std::unique_ptr<ObjectModifier>);
+    void release_objects();
 
     void just_shift(GameObject*, Point3);
-    void just_batch_shift(std::vector<GameObject*>, Point3);
+    void just_batch_shift(const std::vector<GameObject*>&, Point3);
     void shift(GameObject*, Point3, DeltaFrame*);
-    void batch_shift(std::vector<GameObject*>, Point3, DeltaFrame*);
+    void batch_shift(const std::vector<GameObject*>&, Point3, DeltaFrame*);
 
     void serialize(MapFileO& file) const;
 
     void draw(GraphicsManager*, float angle);
+    // Drawing does this too, once a frame
+    void update_effects();
     void draw_layer(GraphicsManager*, int z);
 
     void shift_all_objects(Point3 d);
@@ -68,45 +112,156 @@ public:
 
     void set_initial_state(bool editor_mode);
     void reset_local_state();
+    // The part of reset_local_state which is safe in the middle of a move
+    void reset_listener_state();
 
     void initialize_automatic_snake_links();
 
     void push_signaler(std::unique_ptr<Signaler>);
+    // Signalers keep their place in the room's list during play, so undo
+    // refers to them by index rather than by pointer; each one knows its own
+    int signaler_index(Signaler*);
+    Signaler* signaler(int index);
+    void mark_signaler_dirty(Signaler*);
     void check_signalers(DeltaFrame*, MoveProcessor*);
     void remove_signaler(Signaler*);
     void remove_obj_from_signalers(ObjectModifier*);
 
-    void remove_agent(GameObject* obj);
-
     void add_listener(ObjectModifier*, Point3);
-    void remove_listener(ObjectModifier*, Point3);
+    void remove_listener(ObjectModifier*);
     void activate_listeners_at(Point3);
     void activate_listener_of(ObjectModifier* obj);
+    void flush_events();
     void alert_activated_listeners(DeltaFrame*, MoveProcessor*);
 
     void make_fall_trail(GameObject*, int height, int drop);
 
+    DirtyTracker* dirty_tracker();
+
+    // The blocks stuck to obj at sticky_level (including obj), not counting
+    // one-way links; valid until the map next changes
+    const std::vector<GameObject*>& sticky_group(GameObject* obj, Sticky sticky_level);
+    // For objects whose color changes while they're in the map
+    void update_color(GameObject* obj);
+
+    // Adds every gravitable object which might have lost its support since
+    // the last call: whatever was put, and whatever rested on or stuck to
+    // whatever was taken (or changed color)
+    void collect_fall_check(std::vector<GameObject*>& fall_check);
+    // For changes whose consequences have already been dealt with,
+    // or (after an undo) never need to be
+    void forget_support_changes();
+
+    // Calls f(mod) for every live modifier of the leaf class T
+    template <typename T, typename F>
+    void for_each_modifier(F f) {
+        modifiers_[static_cast<int>(T::KIND)].for_each([&f](ObjectModifier* mod) {
+            f(static_cast<T*>(mod));
+        });
+    }
+
 // Public "private" members
     int width_;
     int height_;
     int depth_;
 
-    std::vector<GameObject*> agents_;
+    // Live (created and not destroyed) objects of each kind, in creation order.
+    // These include abstract objects, which aren't currently in the map.
+    ObjectIndex<GameObject> agents_;
+    ObjectIndex<SnakeBlock> snakes_;
+    ObjectIndex<GameObject> gravitables_;
+    // Live modifiers, one list per ModCode, so that a pass over one kind
+    // of modifier doesn't have to look at (or dispatch through) the rest
+    std::vector<ObjectIndex<ObjectModifier>> modifiers_;
+    // Everything created by create_abstract (and not destroyed), whether or not it's been put since
+    std::vector<GameObject*> abstract_objs_;
 
     GameObjectArray& obj_array_;
 private:
+    void rebuild_listener_flags();
+    void forget_events_of(GameObject*);
+    void record_moved(GameObject*);
+    void forget_moved(ObjectModifier*);
+    void add_to_indices(GameObject*);
+    void remove_from_indices(GameObject*);
+    void record_support_change(SupportChange change);
+    template <typename T>
+    void settle_listeners();
+    template <typename T>
+    bool alert_listeners(unsigned int& alerted, DeltaFrame*, MoveProcessor*);
+
+    std::unique_ptr<MapLayer> make_layer(MapCode type);
+    MapCode dense_layer_type();
+
     std::vector<std::unique_ptr<MapLayer>> layers_;
+    std::unique_ptr<BitLayer> walls_;
+    // Every occupied cell, by column, kept up to date by set and the wall methods
+    std::unique_ptr<ColumnIndex> columns_;
 
+    // A cell's bit is set iff it has an entry in listeners_, so that the
+    // usual case of there being no listener is a single bit test.
+    // (Listeners may be just outside the map, where there's no bit.)
+    std::unique_ptr<BitLayer> listener_flags_;
     std::unordered_map<Point3, std::vector<ObjectModifier*>, Point3Hash> listeners_;
     std::vector<std::unique_ptr<Signaler>> signalers_;
+    // Signalers whose count may no longer agree with their state;
+    // only these need to be looked at by check_signalers
+    std::vector<Signaler*> dirty_signalers_;
+
+    // Each modifier is queued at most once per generation, in activation order,
+    // so that callbacks run in the same order on every machine.
+    // There's one queue per ModCode, since callbacks run a kind at a time.
+    // Generations are unique across rooms, since modifiers can change rooms.
+    std::vector<std::vector<ObjectModifier*>> activated_listeners_;
+    unsigned int listener_gen_;
+    // Shared by listener and event generations
+    static unsigned int next_listener_gen_;
 
-    std::unordered_set<ObjectModifier*> activated_listeners_;
+    // The cells entered and vacated since the last flush_events, in order
+    std::vector<MapEvent> events_;
+    // Modifiers whose objects were taken or put since the last flush_events,
+    // one list per ModCode.  Each is listed once per event generation, so
+    // modifiers only move their listeners once per flush, however many
+    // times their object was taken and put in between.
+    std::vector<std::vector<ObjectModifier*>> moved_modifiers_;
+    unsigned int event_gen_;
+
+    // Every change to the map's contents since collect_fall_check
+    // (or since an undo changed this map)
+    std::vector<SupportChange> support_changes_;
+    // Nothing falls in the editor, so its maps don't keep track
+    bool records_support_;
 
     // TODO: find more appropriate place for this
     std::unique_ptr<Effects> effects_;
 
+    std::unique_ptr<DirtyTracker> dirty_;
+    std::unique_ptr<StickyCache> sticky_cache_;
+
     // For providing direct signaler access
     friend class SwitchTab;
 };
 
+template <typename F>
+void RoomMap::for_each_in_rect(MapRect rect, F&& f) const {
+    // Not depth_, which extend_by and shift_by update after removing layers
+    for (int z = 0; z < (int)layers_.size(); ++z) {
+        for_each_in_layer(z, rect, f);
+    }
+}
+
+// Dispatch on the layer type once, so that f can be inlined into the scan
+template <typename F>
+void RoomMap::for_each_in_layer(int z, MapRect rect, F&& f) const {
+    MapLayer* layer = layers_[z].get();
+    MapCode type = layer->type();
+    if (type == MapCode::FullLayer) {
+        static_cast<FullMapLayer*>(layer)->for_each_in_rect(rect, f);
+    } else if (type == MapCode::SparseLayer) {
+        static_cast<SparseMapLayer*>(layer)->for_each_in_rect(rect, f);
+    } else if (type == MapCode::ChunkedLayer) {
+        static_cast<ChunkedMapLayer*>(layer)->for_each_in_rect(rect, f);
+    }
+}
+
 #endif // ROOMMAP_H
@@ -4,6 +4,8 @@
 #include <vector>
 #include <string>
 
+#include "gameobjectarray.h"
+
 class Switchable;
 class Switch;
 class RoomMap;
@@ -30,15 +32,24 @@ public:
     void remove_object(ObjectModifier*);
 
 private:
-    std::vector<Switch*> switches_;
-    std::vector<Switchable*> switchables_;
+    // The handles of the modifiers' parents;
+    // remove_object takes a modifier out of these when it's destroyed
+    std::vector<GameObjectHandle> switches_;
+    std::vector<GameObjectHandle> switchables_;
     std::string label_;
     int count_;
     int threshold_;
     bool active_;
     bool persistent_;
 
+    // The room whose dirty_signalers_ this joins when its count changes
+    RoomMap* map_;
+    // Where this is in the room's list of signalers
+    int index_;
+    bool dirty_;
+
     friend class SwitchTab;
+    friend class RoomMap;
 };
 
 #endif // SIGNALER_H
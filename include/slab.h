@@ -0,0 +1,58 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Hands out fixed size blocks carved out of large chunks, so that objects
+// of one type end up next to each other in memory, and loading a room full
+// of them takes a few allocations rather than one per object.
+// Freed blocks are reused (most recently freed first); chunks are only
+// released when the Slab itself goes away.
+class Slab {
+public:
+    Slab(std::size_t size);
+    ~Slab();
+
+    void* alloc();
+    void free(void* block);
+
+private:
+    void add_chunk();
+
+    std::size_t size_;
+    unsigned int next_chunk_count_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    // Each free block starts with a pointer to the next one
+    void* free_list_;
+};
+
+// Every type gets its own Slab
+template <typename T>
+Slab& slab_of() {
+    static Slab slab {sizeof(T)};
+    return slab;
+}
+
+// For use in class specific operator new and delete.  A subclass which
+// doesn't declare its own (and so is a different size) just gets the heap.
+template <typename T>
+void* slab_new(std::size_t size) {
+    if (size == sizeof(T)) {
+        return slab_of<T>().alloc();
+    }
+    return ::operator new(size);
+}
+
+template <typename T>
+void slab_delete(void* block, std::size_t size) {
+    if (size == sizeof(T)) {
+        slab_of<T>().free(block);
+    } else {
+        ::operator delete(block);
+    }
+}
+
+#endif // SLAB_H
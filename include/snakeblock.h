@@ -2,21 +2,24 @@
 #define SNAKEBLOCK_H
 
 #include <memory>
-#include <unordered_set>
 
 #include "gameobject.h"
+#include "movearena.h"
 
 class SnakeBlock: public GameObject {
 public:
     SnakeBlock(Point3 pos, int color, bool pushable, bool gravitable, int ends);
     virtual ~SnakeBlock();
 
+    static void* operator new(std::size_t size);
+    static void operator delete(void* block, std::size_t size);
+
     virtual std::string name();
     virtual ObjCode obj_code();
     void serialize(MapFileO& file);
     static std::unique_ptr<GameObject> deserialize(MapFileI& file);
     bool relation_check();
-    void relation_serialize(MapFileO& file);
+    void relation_serialize(MapFileO& file, GameObjectArray&);
 
     void collect_sticky_links(RoomMap*, Sticky sticky_level, std::vector<GameObject*>& links);
 
@@ -36,28 +39,34 @@ public:
     bool can_link(SnakeBlock*);
 
     void draw(GraphicsManager*);
+    void draw_links(GraphicsManager*, GameObjectArray&);
 
     bool available();
     bool confused(RoomMap*);
-    void collect_maybe_confused_neighbors(RoomMap*, std::unordered_set<SnakeBlock*>& check);
+    void collect_maybe_confused_neighbors(RoomMap*, std::vector<SnakeBlock*>& check);
     void update_links_color(RoomMap*, DeltaFrame*);
     void check_add_local_links(RoomMap*, DeltaFrame*);
-    void break_unmoving_links(std::vector<GameObject*>& fall_check, DeltaFrame*);
+    void break_unmoving_links(RoomMap*, std::vector<GameObject*>& fall_check, DeltaFrame*);
 
     void reset_internal_state();
 
     virtual void cleanup_on_destruction(RoomMap*);
     virtual void setup_on_undestruction(RoomMap*);
 
-    std::unique_ptr<SnakeBlock> make_split_copy(RoomMap*, DeltaFrame*);
+    SnakeBlock* make_split_copy(RoomMap*, DeltaFrame*);
 
     Sticky sticky();
 
-    std::vector<SnakeBlock*> links_;
+    // Mirrored on both ends
+    std::vector<GameObjectHandle> links_;
     SnakeBlock* target_;
     int ends_;
     unsigned int distance_;
     bool dragged_;
+    // Position in the RoomMap's snake index
+    int snake_slot_;
+
+    static const ObjCode KIND = ObjCode::SnakeBlock;
 };
 
 SnakeBlock* snake_cast(GameObject* obj);
@@ -67,7 +76,7 @@ class SnakePuller {
 public:
     SnakePuller(RoomMap*, DeltaFrame*,
                 std::vector<GameObject*>& moving_blocks,
-                std::unordered_set<SnakeBlock*>& link_add_check,
+                std::vector<SnakeBlock*>& link_add_check,
                 std::vector<GameObject*>& fall_check);
     ~SnakePuller();
     void prepare_pull(SnakeBlock*);
@@ -76,9 +85,9 @@ public:
 private:
     RoomMap* map_;
     DeltaFrame* delta_frame_;
-    std::vector<SnakeBlock*> snakes_to_pull_;
+    ScratchVector<SnakeBlock*> snakes_to_pull_;
     std::vector<GameObject*>& moving_blocks_;
-    std::unordered_set<SnakeBlock*>& link_add_check_;
+    std::vector<SnakeBlock*>& link_add_check_;
     std::vector<GameObject*>& fall_check_;
 };
 
@@ -0,0 +1,50 @@
+#ifndef STICKYCACHE_H
+#define STICKYCACHE_H
+
+#include <vector>
+
+#include "common_enums.h"
+
+class GameObject;
+class RoomMap;
+
+// Remembers which blocks are stuck together, so that pushes and falls
+// don't have to rediscover a group by searching outward from one of its
+// blocks every time.  A group is the set of blocks joined (at one sticky
+// level) by ordinary stickiness, i.e. collect_sticky_links; one-way links
+// like a Player riding a Car are left for collect_sticky_component.
+// Groups are only cached at the levels components are built at (Strong
+// for pushes, All for falls).  Anything that could join or split a group
+// (an object entering or leaving a cell, or changing color) drops the
+// groups at and around it, and they're rebuilt the next time they're asked
+// for.  Snake links change on nearly every move, so groups of snakes
+// (which never include anything else) are always rebuilt.
+class StickyCache {
+public:
+    StickyCache(RoomMap* room_map);
+    ~StickyCache();
+
+    // Valid until the next call
+    const std::vector<GameObject*>& group(GameObject* obj, Sticky sticky_level);
+
+    // Forget every group which obj or its neighbors belong to
+    void invalidate(GameObject* obj);
+    void reset();
+
+private:
+    void build(GameObject* start, Sticky sticky_level, std::vector<GameObject*>& members);
+    void drop_group_of(int id);
+
+    RoomMap* map_;
+    // For each object id, its group at each cached level (or -1)
+    std::vector<int> strong_group_of_;
+    std::vector<int> all_group_of_;
+    std::vector<std::vector<GameObject*>> groups_;
+    std::vector<int> free_groups_;
+    std::vector<GameObject*> uncached_;
+    // Marks objects already reached by the current build
+    std::vector<unsigned int> visited_;
+    unsigned int visit_stamp_;
+};
+
+#endif // STICKYCACHE_H
@@ -11,7 +11,7 @@ class Signaler;
 
 class Switch: public ObjectModifier {
 public:
-    Switch(GameObject* parent, bool persistent, bool active);
+    Switch(GameObject* parent, ModCode kind, bool persistent, bool active);
     virtual ~Switch();
 
     void push_signaler(Signaler*);
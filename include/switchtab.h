@@ -5,9 +5,8 @@
 #include <vector>
 
 #include "editortab.h"
+#include "gameobjectarray.h"
 
-class Switch;
-class Switchable;
 class Signaler;
 
 class SwitchTab: public EditorTab {
@@ -23,8 +22,9 @@ public:
     int get_signaler_labels(const char* labels[], std::vector<std::unique_ptr<Signaler>>& signalers);
 
 private:
-    std::vector<Switch*> model_switches_;
-    std::vector<Switchable*> model_switchables_;
+    // The handles of the modifiers' parents, as in a Signaler
+    std::vector<GameObjectHandle> model_switches_;
+    std::vector<GameObjectHandle> model_switchables_;
     bool model_persistent_;
     int model_threshold_;
 };
@@ -13,6 +13,8 @@ public:
 
     bool skip_serialization();
     void draw(GraphicsManager*);
+
+    static const ObjCode KIND = ObjCode::Wall;
 };
 
 #endif // WALL_H
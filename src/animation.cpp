@@ -1,6 +1,7 @@
 #include "animation.h"
 
 #include "common_constants.h"
+#include "slab.h"
 
 Animation::Animation(): frames_ {} {}
 
@@ -18,6 +19,14 @@ LinearAnimation::LinearAnimation(Point3 d): PositionalAnimation(), d_ {d} {
 
 LinearAnimation::~LinearAnimation() {}
 
+void* LinearAnimation::operator new(std::size_t size) {
+    return slab_new<LinearAnimation>(size);
+}
+
+void LinearAnimation::operator delete(void* block, std::size_t size) {
+    slab_delete<LinearAnimation>(block, size);
+}
+
 FPoint3 LinearAnimation::dpos() {
     return (-(float)frames_/(float)HORIZONTAL_MOVEMENT_FRAMES)*FPoint3{d_};
 }
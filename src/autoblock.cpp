@@ -1,11 +1,21 @@
 #include "autoblock.h"
 
+#include "slab.h"
 #include "gameobject.h"
+#include "roommap.h"
 
-AutoBlock::AutoBlock(GameObject* parent, RoomMap* room_map): ObjectModifier(parent), map_ {room_map} {}
+AutoBlock::AutoBlock(GameObject* parent, RoomMap* room_map): ObjectModifier(parent, ModCode::AutoBlock), map_ {room_map} {}
 
 AutoBlock::~AutoBlock() {}
 
+void* AutoBlock::operator new(std::size_t size) {
+    return slab_new<AutoBlock>(size);
+}
+
+void AutoBlock::operator delete(void* block, std::size_t size) {
+    slab_delete<AutoBlock>(block, size);
+}
+
 std::string AutoBlock::name() {
     return "AutoBlock";
 }
@@ -14,10 +24,10 @@ ModCode AutoBlock::mod_code() {
     return ModCode::AutoBlock;
 }
 
-void AutoBlock::serialize(MapFileO&) {}
+void AutoBlock::serialize(MapFileO&, GameObjectArray&) {}
 
 void AutoBlock::deserialize(MapFileI& file, RoomMap* room_map, GameObject* parent) {
-    parent->set_modifier(std::make_unique<AutoBlock>(parent, room_map));
+    room_map->set_modifier(parent, std::make_unique<AutoBlock>(parent, room_map));
 }
 
 bool AutoBlock::is_agent() {
@@ -36,10 +36,8 @@ float CameraContext::rotation(FPoint3 pos) {
 }
 
 void CameraContext::serialize(MapFileO& file) {
-    file << x_;
-    file << y_;
-    file << w_;
-    file << h_;
+    file << Point2{x_, y_};
+    file << Point2{w_, h_};
     file << priority_;
 }
 
@@ -73,10 +71,11 @@ void FreeCameraContext::serialize(MapFileO& file) {
 }
 
 CameraContext* FreeCameraContext::deserialize(MapFileI& file) {
-    int x, y, w, h, p;
+    Point2 pos, size;
+    int p;
     float rad, tilt, rot;
-    file >> x >> y >> w >> h >> p >> rad >> tilt >> rot;
-    return new FreeCameraContext(x, y, w, h, p, rad, tilt, rot);
+    file >> pos >> size >> p >> rad >> tilt >> rot;
+    return new FreeCameraContext(pos.x, pos.y, size.x, size.y, p, rad, tilt, rot);
 }
 
 
@@ -111,11 +110,12 @@ void FixedCameraContext::serialize(MapFileO& file) {
 }
 
 CameraContext* FixedCameraContext::deserialize(MapFileI& file) {
-    int x, y, w, h, p;
+    Point2 pos, size;
+    int p;
     float rad, tilt, rot;
     FPoint3 center {};
-    file >> x >> y >> w >> h >> p >> rad >> tilt >> rot >> center;
-    return new FixedCameraContext(x, y, w, h, p, rad, tilt, rot, center);
+    file >> pos >> size >> p >> rad >> tilt >> rot >> center;
+    return new FixedCameraContext(pos.x, pos.y, size.x, size.y, p, rad, tilt, rot, center);
 }
 
 ClampedCameraContext::ClampedCameraContext(int x, int y, int w, int h, int priority, float radius, float tilt, int xpad, int ypad):
@@ -144,15 +144,15 @@ void ClampedCameraContext::serialize(MapFileO& file) {
     CameraContext::serialize(file);
     file << radius_;
     file << tilt_;
-    file << xpad_;
-    file << ypad_;
+    file << Point2{xpad_, ypad_};
 }
 
 CameraContext* ClampedCameraContext::deserialize(MapFileI& file) {
-    int x, y, w, h, p, xpad, ypad;
+    Point2 pos, size, pad;
+    int p;
     float rad, tilt;
-    file >> x >> y >> w >> h >> p >> rad >> tilt >> xpad >> ypad;
-    return new ClampedCameraContext(x, y, w, h, p, rad, tilt, xpad, ypad);
+    file >> pos >> size >> p >> rad >> tilt >> pad;
+    return new ClampedCameraContext(pos.x, pos.y, size.x, size.y, p, rad, tilt, pad.x, pad.y);
 }
 
 NullCameraContext::NullCameraContext(int x, int y, int w, int h, int priority):
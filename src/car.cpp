@@ -1,13 +1,22 @@
 #include "car.h"
 
+#include "slab.h"
 #include "gameobject.h"
 #include "roommap.h"
 #include "player.h"
 
-Car::Car(GameObject* parent, ColorCycle color_cycle): ObjectModifier(parent), color_cycle_ {color_cycle} {}
+Car::Car(GameObject* parent, ColorCycle color_cycle): ObjectModifier(parent, ModCode::Car), color_cycle_ {color_cycle} {}
 
 Car::~Car() {}
 
+void* Car::operator new(std::size_t size) {
+    return slab_new<Car>(size);
+}
+
+void Car::operator delete(void* block, std::size_t size) {
+    slab_delete<Car>(block, size);
+}
+
 std::string Car::name() {
     return "Car";
 }
@@ -16,20 +25,20 @@ ModCode Car::mod_code() {
     return ModCode::Car;
 }
 
-void Car::serialize(MapFileO& file) {
+void Car::serialize(MapFileO& file, GameObjectArray&) {
     // Ensures color consistency with parent object!
     color_cycle_.set_current(parent_->color_);
     file << color_cycle_;
 }
 
-void Car::deserialize(MapFileI& file, RoomMap*, GameObject* parent) {
+void Car::deserialize(MapFileI& file, RoomMap* room_map, GameObject* parent) {
     ColorCycle color_cycle;
     file >> color_cycle;
-    parent->set_modifier(std::make_unique<Car>(parent, color_cycle));
+    room_map->set_modifier(parent, std::make_unique<Car>(parent, color_cycle));
 }
 
 void Car::collect_sticky_links(RoomMap* room_map, Sticky, std::vector<GameObject*>& to_check) {
-    Player* player = dynamic_cast<Player*>(room_map->view(pos_above()));
+    Player* player = kind_cast<Player>(room_map->view(pos_above()));
     if (player) {
         to_check.push_back(player);
     }
@@ -1,20 +1,52 @@
 #include "component.h"
 
+#include <algorithm>
+
 #include "gameobject.h"
 #include "roommap.h"
 
+Component::Component(bool falling): blocks_ {}, falling_ {falling} {}
+
 Component::~Component() {
     for (GameObject* block : blocks_) {
         block->comp_ = nullptr;
     }
 }
 
+void Component::clear() {
+    for (GameObject* block : blocks_) {
+        block->comp_ = nullptr;
+    }
+    blocks_.clear();
+}
+
+
+PushComponent::PushComponent(): Component(false),
+pushing_ {}, blocked_ {false}, moving_ {false} {}
+
+void PushComponent::clear() {
+    Component::clear();
+    pushing_.clear();
+    blocked_ = false;
+    moving_ = false;
+}
 
 void PushComponent::add_pushing(Component* comp) {
     pushing_.push_back(static_cast<PushComponent*>(comp));
 }
 
 
+FallComponent::FallComponent(): Component(true),
+above_ {}, positions_ {}, drop_ {0}, settled_ {false} {}
+
+void FallComponent::clear() {
+    Component::clear();
+    above_.clear();
+    positions_.clear();
+    drop_ = 0;
+    settled_ = false;
+}
+
 void FallComponent::add_above(Component* comp) {
     above_.push_back(static_cast<FallComponent*>(comp));
 }
@@ -31,5 +63,13 @@ void FallComponent::settle_first() {
 void FallComponent::take_falling(RoomMap* room_map) {
     for (GameObject* block : blocks_) {
         room_map->take(block);
+        positions_.push_back(block->pos_);
+        drop_ = std::max(drop_, block->pos_.z + 1);
+    }
+}
+
+void FallComponent::update_positions() {
+    for (unsigned int i = 0; i < blocks_.size(); ++i) {
+        blocks_[i]->pos_ = positions_[i];
     }
 }
@@ -1,6 +1,7 @@
 #include "delta.h"
 
 #include "gameobject.h"
+#include "gameobjectarray.h"
 #include "room.h"
 #include "roommap.h"
 
@@ -12,16 +13,35 @@
 #include "signaler.h"
 #include "playingstate.h"
 #include "gatebody.h"
+#include "movearena.h"
+#include "slab.h"
 
 Delta::~Delta() {}
 
+void Delta::collect_changed_maps(std::vector<RoomMap*>&) {}
+
 DeltaFrame::DeltaFrame(): deltas_ {}, changed_ {false} {}
 
 DeltaFrame::~DeltaFrame() {}
 
-void DeltaFrame::revert() {
+void* DeltaFrame::operator new(std::size_t size) {
+    return slab_new<DeltaFrame>(size);
+}
+
+void DeltaFrame::operator delete(void* block, std::size_t size) {
+    slab_delete<DeltaFrame>(block, size);
+}
+
+// What an undo does to support is never anything a fall step should look
+// at, so the maps it changed forget their support changes afterwards
+void DeltaFrame::revert(GameObjectArray& objs) {
+    ScratchVector<RoomMap*> changed_maps {};
     for (auto it = deltas_.rbegin(); it != deltas_.rend(); ++it) {
-        (**it).revert();
+        (**it).collect_changed_maps(changed_maps);
+        (**it).revert(objs);
+    }
+    for (RoomMap* room_map : changed_maps) {
+        room_map->forget_support_changes();
     }
 }
 
@@ -43,18 +63,22 @@ bool DeltaFrame::changed() {
 }
 
 
-UndoStack::UndoStack(unsigned int max_depth): frames_ {}, max_depth_ {max_depth}, size_ {0} {}
+UndoStack::UndoStack(GameObjectArray& objs, unsigned int max_depth):
+frames_ (max_depth), objs_ {objs}, max_depth_ {max_depth}, first_ {0}, size_ {0}, dropped_ {0} {}
 
 UndoStack::~UndoStack() {}
 
 void UndoStack::push(std::unique_ptr<DeltaFrame> delta_frame) {
     if (!delta_frame->trivial()) {
         if (size_ == max_depth_) {
-            frames_.pop_front();
+            // The oldest frame goes, and its slot becomes the newest
+            frames_[first_] = std::move(delta_frame);
+            first_ = (first_ + 1) % max_depth_;
+            ++dropped_;
         } else {
+            frames_[(first_ + size_) % max_depth_] = std::move(delta_frame);
             ++size_;
         }
-        frames_.push_back(std::move(delta_frame));
     }
 }
 
@@ -63,52 +87,86 @@ bool UndoStack::non_empty() {
 }
 
 void UndoStack::pop() {
-    frames_.back()->revert();
-    frames_.pop_back();
+    std::unique_ptr<DeltaFrame>& last = frames_[(first_ + size_ - 1) % max_depth_];
+    last->revert(objs_);
+    last.reset(nullptr);
     --size_;
 }
 
+// Oldest first, as the frames would have been dropped
 void UndoStack::reset() {
-    frames_.clear();
+    for (unsigned int i = 0; i < size_; ++i) {
+        frames_[(first_ + i) % max_depth_].reset(nullptr);
+    }
+    first_ = 0;
+    dropped_ += size_;
     size_ = 0;
 }
 
+unsigned int UndoStack::oldest_frame() {
+    return dropped_;
+}
+
+unsigned int UndoStack::next_frame() {
+    return dropped_ + size_;
+}
 
-CreationDelta::CreationDelta(GameObject* obj, RoomMap* room_map): obj_ {obj}, map_ {room_map} {}
+
+CreationDelta::CreationDelta(GameObject* obj, RoomMap* room_map): obj_ {obj->handle()}, map_ {room_map} {}
 
 CreationDelta::~CreationDelta() {}
 
-void CreationDelta::revert() {
-    map_->uncreate(obj_);
+void CreationDelta::revert(GameObjectArray& objs) {
+    map_->uncreate(objs.get(obj_));
 }
 
+void CreationDelta::collect_changed_maps(std::vector<RoomMap*>& maps) {
+    push_unique(maps, map_);
+}
 
-DeletionDelta::DeletionDelta(GameObject* obj, RoomMap* room_map):
-obj_ {obj}, map_ {room_map} {}
 
-DeletionDelta::~DeletionDelta() {}
+DeletionDelta::DeletionDelta(GameObject* obj, RoomMap* room_map, bool abstract):
+obj_ {obj->handle()}, map_ {room_map}, obj_array_ {room_map->obj_array_}, abstract_ {abstract}, reverted_ {false} {}
 
-void DeletionDelta::revert() {
-    map_->undestroy(obj_);
+DeletionDelta::~DeletionDelta() {
+    if (!reverted_) {
+        // The handle is stale if the object was already freed some other way
+        if (GameObject* obj = obj_array_.get(obj_)) {
+            obj_array_.destroy(obj);
+        }
+    }
+}
+
+void DeletionDelta::revert(GameObjectArray& objs) {
+    map_->undestroy(objs.get(obj_), abstract_);
+    reverted_ = true;
+}
+
+void DeletionDelta::collect_changed_maps(std::vector<RoomMap*>& maps) {
+    push_unique(maps, map_);
 }
 
 
-AbstractCreationDelta::AbstractCreationDelta(GameObject* obj, RoomMap* room_map): obj_ {obj}, map_ {room_map} {}
+AbstractCreationDelta::AbstractCreationDelta(GameObject* obj, RoomMap* room_map): obj_ {obj->handle()}, map_ {room_map} {}
 
 AbstractCreationDelta::~AbstractCreationDelta() {}
 
-void AbstractCreationDelta::revert() {
-    map_->uncreate_abstract(obj_);
+void AbstractCreationDelta::revert(GameObjectArray& objs) {
+    map_->uncreate_abstract(objs.get(obj_));
 }
 
 
 PutDelta::PutDelta(GameObject* obj, RoomMap* room_map):
-obj_ {obj}, map_ {room_map} {}
+obj_ {obj->handle()}, map_ {room_map} {}
 
 PutDelta::~PutDelta() {}
 
-void PutDelta::revert() {
-    map_->just_take(obj_);
+void PutDelta::revert(GameObjectArray& objs) {
+    map_->just_take(objs.get(obj_));
+}
+
+void PutDelta::collect_changed_maps(std::vector<RoomMap*>& maps) {
+    push_unique(maps, map_);
 }
 
 
@@ -116,138 +174,207 @@ void PutDelta::revert() {
 // until it has been Put back into the map, so there's no need
 // to record its old position in the delta.
 TakeDelta::TakeDelta(GameObject* obj, RoomMap* room_map):
-obj_ {obj}, map_ {room_map} {}
+obj_ {obj->handle()}, map_ {room_map} {}
 
 TakeDelta::~TakeDelta() {}
 
-void TakeDelta::revert() {
-    map_->just_put(obj_);
+void TakeDelta::revert(GameObjectArray& objs) {
+    map_->just_put(objs.get(obj_));
+}
+
+void TakeDelta::collect_changed_maps(std::vector<RoomMap*>& maps) {
+    push_unique(maps, map_);
 }
 
 
 MotionDelta::MotionDelta(GameObject* obj, Point3 dpos, RoomMap* room_map):
-obj_ {obj}, dpos_ {dpos}, map_ {room_map} {}
+obj_ {obj->handle()}, dpos_ {dpos}, map_ {room_map} {}
 
 MotionDelta::~MotionDelta() {}
 
-void MotionDelta::revert() {
-    map_->just_shift(obj_, -dpos_);
+void* MotionDelta::operator new(std::size_t size) {
+    return slab_new<MotionDelta>(size);
+}
+
+void MotionDelta::operator delete(void* block, std::size_t size) {
+    slab_delete<MotionDelta>(block, size);
+}
+
+void MotionDelta::revert(GameObjectArray& objs) {
+    map_->just_shift(objs.get(obj_), -dpos_);
 }
 
+void MotionDelta::collect_changed_maps(std::vector<RoomMap*>& maps) {
+    push_unique(maps, map_);
+}
 
-BatchMotionDelta::BatchMotionDelta(std::vector<GameObject*> objs, Point3 dpos, RoomMap* room_map):
-objs_ {objs}, dpos_ {dpos}, map_ {room_map} {}
+
+BatchMotionDelta::BatchMotionDelta(const std::vector<GameObject*>& objs, Point3 dpos, RoomMap* room_map):
+objs_ {}, dpos_ {dpos}, map_ {room_map} {
+    objs_.reserve(objs.size());
+    for (GameObject* obj : objs) {
+        objs_.push_back(obj->handle());
+    }
+}
 
 BatchMotionDelta::~BatchMotionDelta() {}
 
-void BatchMotionDelta::revert() {
-    map_->just_batch_shift(objs_, -dpos_);
+void* BatchMotionDelta::operator new(std::size_t size) {
+    return slab_new<BatchMotionDelta>(size);
+}
+
+void BatchMotionDelta::operator delete(void* block, std::size_t size) {
+    slab_delete<BatchMotionDelta>(block, size);
+}
+
+void BatchMotionDelta::revert(GameObjectArray& objs) {
+    ScratchVector<GameObject*> resolved {};
+    for (GameObjectHandle h : objs_) {
+        resolved.push_back(objs.get(h));
+    }
+    map_->just_batch_shift(resolved, -dpos_);
+}
+
+void BatchMotionDelta::collect_changed_maps(std::vector<RoomMap*>& maps) {
+    push_unique(maps, map_);
 }
 
 
 AbstractMotionDelta::AbstractMotionDelta(GameObject* obj, Point3 dpos):
-obj_ {obj}, dpos_ {dpos} {}
+obj_ {obj->handle()}, dpos_ {dpos} {}
 
 AbstractMotionDelta::~AbstractMotionDelta() {}
 
-void AbstractMotionDelta::revert() {
-    obj_->pos_ -= dpos_;
+void AbstractMotionDelta::revert(GameObjectArray& objs) {
+    objs.get(obj_)->pos_ -= dpos_;
 }
 
 
-AddLinkDelta::AddLinkDelta(SnakeBlock* a, SnakeBlock* b): a_ {a}, b_ {b} {}
+AddLinkDelta::AddLinkDelta(SnakeBlock* a, SnakeBlock* b): a_ {a->handle()}, b_ {b->handle()} {}
 
 AddLinkDelta::~AddLinkDelta() {}
 
-void AddLinkDelta::revert() {
-    a_->remove_link_quiet(b_);
+void* AddLinkDelta::operator new(std::size_t size) {
+    return slab_new<AddLinkDelta>(size);
 }
 
+void AddLinkDelta::operator delete(void* block, std::size_t size) {
+    slab_delete<AddLinkDelta>(block, size);
+}
+
+void AddLinkDelta::revert(GameObjectArray& objs) {
+    SnakeBlock* a = static_cast<SnakeBlock*>(objs.get(a_));
+    a->remove_link_quiet(static_cast<SnakeBlock*>(objs.get(b_)));
+}
 
-RemoveLinkDelta::RemoveLinkDelta(SnakeBlock* a, SnakeBlock* b): a_ {a}, b_ {b} {}
+
+RemoveLinkDelta::RemoveLinkDelta(SnakeBlock* a, SnakeBlock* b): a_ {a->handle()}, b_ {b->handle()} {}
 
 RemoveLinkDelta::~RemoveLinkDelta() {}
 
-void RemoveLinkDelta::revert() {
-    a_->add_link_quiet(b_);
+void* RemoveLinkDelta::operator new(std::size_t size) {
+    return slab_new<RemoveLinkDelta>(size);
+}
+
+void RemoveLinkDelta::operator delete(void* block, std::size_t size) {
+    slab_delete<RemoveLinkDelta>(block, size);
+}
+
+void RemoveLinkDelta::revert(GameObjectArray& objs) {
+    SnakeBlock* a = static_cast<SnakeBlock*>(objs.get(a_));
+    a->add_link_quiet(static_cast<SnakeBlock*>(objs.get(b_)));
 }
 
 
 DoorMoveDelta::DoorMoveDelta(PlayingState* state, Room* room, std::vector<GameObject*>& objs):
 state_ {state}, room_ {room}, pairs_ {} {
     for (GameObject* obj : objs) {
-        pairs_.push_back(std::make_pair(obj, obj->pos_));
+        pairs_.push_back(std::make_pair(obj->handle(), obj->pos_));
     }
 }
 
 DoorMoveDelta::~DoorMoveDelta() {}
 
-void DoorMoveDelta::revert() {
+void DoorMoveDelta::revert(GameObjectArray& objs) {
     RoomMap* cur_map = state_->room_->map();
     RoomMap* dest_map = room_->map();
     state_->room_ = room_;
     for (auto& p : pairs_) {
-        GameObject* obj = p.first;
+        GameObject* obj = objs.get(p.first);
         cur_map->just_take(obj);
         obj->pos_ = p.second;
         dest_map->just_put(obj);
     }
 }
 
+void DoorMoveDelta::collect_changed_maps(std::vector<RoomMap*>& maps) {
+    push_unique(maps, state_->room_->map());
+    push_unique(maps, room_->map());
+}
+
 
 SwitchableDelta::SwitchableDelta(Switchable* obj, bool active, bool waiting):
-obj_ {obj}, active_ {active}, waiting_ {waiting} {}
+obj_ {obj->parent_->handle()}, active_ {active}, waiting_ {waiting} {}
 
 SwitchableDelta::~SwitchableDelta() {}
 
-void SwitchableDelta::revert() {
-    obj_->active_ = active_;
-    obj_->waiting_ = waiting_;
+void SwitchableDelta::revert(GameObjectArray& objs) {
+    Switchable* obj = static_cast<Switchable*>(objs.get(obj_)->modifier());
+    obj->active_ = active_;
+    obj->waiting_ = waiting_;
 }
 
 
-SwitchToggleDelta::SwitchToggleDelta(Switch* obj): obj_ {obj} {}
+SwitchToggleDelta::SwitchToggleDelta(Switch* obj): obj_ {obj->parent_->handle()} {}
 
 SwitchToggleDelta::~SwitchToggleDelta() {}
 
-void SwitchToggleDelta::revert() {
-    obj_->toggle();
+void SwitchToggleDelta::revert(GameObjectArray& objs) {
+    static_cast<Switch*>(objs.get(obj_)->modifier())->toggle();
 }
 
 
-SignalerToggleDelta::SignalerToggleDelta(Signaler* sig): sig_ {sig} {}
+SignalerToggleDelta::SignalerToggleDelta(Signaler* sig, RoomMap* room_map):
+map_ {room_map}, sig_index_ {room_map->signaler_index(sig)} {}
 
 SignalerToggleDelta::~SignalerToggleDelta() {}
 
-void SignalerToggleDelta::revert() {
-    sig_->toggle();
+void SignalerToggleDelta::revert(GameObjectArray&) {
+    map_->signaler(sig_index_)->toggle();
 }
 
 
 RidingStateDelta::RidingStateDelta(Player* player, RidingState state):
-player_ {player}, state_ {state} {}
+player_ {player->handle()}, state_ {state} {}
 
 RidingStateDelta::~RidingStateDelta() {}
 
-void RidingStateDelta::revert() {
-    player_->state_ = state_;
+void RidingStateDelta::revert(GameObjectArray& objs) {
+    static_cast<Player*>(objs.get(player_))->state_ = state_;
 }
 
 
-ColorChangeDelta::ColorChangeDelta(Car* car, bool undo): car_ {car}, undo_ {undo} {}
+ColorChangeDelta::ColorChangeDelta(Car* car, RoomMap* room_map, bool undo):
+car_ {car->parent_->handle()}, map_ {room_map}, undo_ {undo} {}
 
 ColorChangeDelta::~ColorChangeDelta() {}
 
-void ColorChangeDelta::revert() {
-    car_->cycle_color(undo_);
+void ColorChangeDelta::revert(GameObjectArray& objs) {
+    GameObject* parent = objs.get(car_);
+    static_cast<Car*>(parent->modifier())->cycle_color(undo_);
+    map_->update_color(parent);
+}
+
+void ColorChangeDelta::collect_changed_maps(std::vector<RoomMap*>& maps) {
+    push_unique(maps, map_);
 }
 
 
 GatePosDelta::GatePosDelta(GateBody* gate_body, Point3 dpos):
-gate_body_ {gate_body}, dpos_ {dpos} {}
+gate_body_ {gate_body->handle()}, dpos_ {dpos} {}
 
 GatePosDelta::~GatePosDelta() {}
 
-void GatePosDelta::revert() {
-    gate_body_->gate_pos_ -= dpos_;
+void GatePosDelta::revert(GameObjectArray& objs) {
+    static_cast<GateBody*>(objs.get(gate_body_))->gate_pos_ -= dpos_;
 }
@@ -0,0 +1,93 @@
+#include "dirtytracker.h"
+
+#include <algorithm>
+
+bool DirtyRegion::empty() {
+    return !everything && cells.empty();
+}
+
+
+const unsigned int DirtyTracker::MAX_LOG_SIZE;
+
+DirtyTracker::DirtyTracker(): log_ {}, log_start_ {0}, subscribers_ {}, active_count_ {0} {}
+
+DirtyTracker::~DirtyTracker() {}
+
+// New subscribers only hear about changes made after they subscribe
+int DirtyTracker::subscribe() {
+    ++active_count_;
+    for (int i = 0; i < (int)subscribers_.size(); ++i) {
+        if (!subscribers_[i].active) {
+            subscribers_[i] = {true, generation()};
+            return i;
+        }
+    }
+    subscribers_.push_back({true, generation()});
+    return subscribers_.size() - 1;
+}
+
+void DirtyTracker::unsubscribe(int sub) {
+    subscribers_[sub].active = false;
+    --active_count_;
+    trim();
+}
+
+unsigned int DirtyTracker::generation() {
+    return log_start_ + log_.size();
+}
+
+void DirtyTracker::mark(Point3 pos) {
+    // With nobody listening, there's nothing to remember
+    if (!active_count_) {
+        ++log_start_;
+        return;
+    }
+    log_.push_back(pos);
+    if (log_.size() > MAX_LOG_SIZE) {
+        trim();
+        if (log_.size() > MAX_LOG_SIZE) {
+            mark_everything();
+        }
+    }
+}
+
+// Skip a generation so that every current subscriber falls before log_start_
+void DirtyTracker::mark_everything() {
+    log_start_ = generation() + 1;
+    log_.clear();
+}
+
+DirtyRegion DirtyTracker::drain(int sub) {
+    DirtyRegion region {{}, {}, {}, false};
+    unsigned int& sub_gen = subscribers_[sub].generation;
+    if (sub_gen < log_start_) {
+        region.everything = true;
+    } else if (sub_gen < generation()) {
+        region.cells.assign(log_.begin() + (sub_gen - log_start_), log_.end());
+        region.min = region.cells[0];
+        region.max = region.cells[0];
+        for (Point3 pos : region.cells) {
+            region.min = {std::min(region.min.x, pos.x), std::min(region.min.y, pos.y), std::min(region.min.z, pos.z)};
+            region.max = {std::max(region.max.x, pos.x), std::max(region.max.y, pos.y), std::max(region.max.z, pos.z)};
+        }
+    }
+    sub_gen = generation();
+    trim();
+    return region;
+}
+
+// Forget everything that all subscribers have already seen
+void DirtyTracker::trim() {
+    unsigned int oldest = generation();
+    for (auto& sub : subscribers_) {
+        if (sub.active) {
+            oldest = std::min(oldest, std::max(sub.generation, log_start_));
+        }
+    }
+    // Erasing from the front is linear, so wait until it's worth it
+    unsigned int seen = oldest - log_start_;
+    if (seen > 0 && 2*seen >= log_.size()) {
+        log_.erase(log_.begin(), log_.begin() + seen);
+        log_start_ = oldest;
+    }
+}
@@ -1,5 +1,6 @@
 #include "door.h"
 
+#include "slab.h"
 #include "mapfile.h"
 #include "gameobject.h"
 #include "graphicsmanager.h"
@@ -9,11 +10,19 @@
 
 MapLocation::MapLocation(Point3_S16 p, const std::string& room_name): pos {p}, name {room_name} {}
 
-Door::Door(GameObject* parent, bool def, bool active): Switchable(parent, def, active, false), dest_ {} {}
+Door::Door(GameObject* parent, bool def, bool active): Switchable(parent, ModCode::Door, def, active, false), dest_ {} {}
 
 Door::~Door() {}
 
-Door::Door(const Door& d): Switchable(d.parent_, d.default_, d.active_, d.waiting_), dest_ {} {}
+void* Door::operator new(std::size_t size) {
+    return slab_new<Door>(size);
+}
+
+void Door::operator delete(void* block, std::size_t size) {
+    slab_delete<Door>(block, size);
+}
+
+Door::Door(const Door& d): Switchable(d.parent_, ModCode::Door, d.default_, d.active_, d.waiting_), dest_ {} {}
 
 std::string Door::name() {
     return "Door";
@@ -31,14 +40,14 @@ MapLocation* Door::dest() {
     return dest_.get();
 }
 
-void Door::serialize(MapFileO& file) {
+void Door::serialize(MapFileO& file, GameObjectArray&) {
     file << default_ << active_;
 }
 
-void Door::deserialize(MapFileI& file, RoomMap*, GameObject* parent) {
+void Door::deserialize(MapFileI& file, RoomMap* room_map, GameObject* parent) {
     unsigned char b[2];
     file.read(b, 2);
-    parent->set_modifier(std::make_unique<Door>(parent, b[0], b[1]));
+    room_map->set_modifier(parent, std::make_unique<Door>(parent, b[0], b[1]));
 }
 
 bool Door::relation_check() {
@@ -66,7 +75,7 @@ void Door::setup_on_put(RoomMap* room_map) {
 }
 
 void Door::cleanup_on_take(RoomMap* room_map) {
-    room_map->remove_listener(this, pos_above());
+    room_map->remove_listener(this);
 }
 
 void Door::draw(GraphicsManager* gfx, FPoint3 p) {
@@ -20,6 +20,7 @@ void Effects::update() {
     for (auto& trail : trails_) {
         --trail.opacity;
     }
+    trails_.erase(std::remove_if(trails_.begin(), trails_.end(), [](FallTrail t) {return t.opacity == 0;}), trails_.end());
 }
 
 void Effects::draw(GraphicsManager* gfx) {
@@ -34,7 +35,6 @@ void Effects::draw(GraphicsManager* gfx) {
         gfx->set_model(model);
         gfx->draw_cube();
     }
-    trails_.erase(std::remove_if(trails_.begin(), trails_.end(), [](FallTrail t) {return t.opacity == 0;}), trails_.end());
 }
 
 void Effects::push_trail(GameObject* block, int height, int drop) {
@@ -1,78 +1,106 @@
 #include "fallstepprocessor.h"
 
 #include <algorithm>
-
+#include <functional>
 
 #include "component.h"
 #include "gameobject.h"
 #include "roommap.h"
 #include "delta.h"
 #include "snakeblock.h"
+#include "gameobjectarray.h"
+#include "common_constants.h"
 
-// Move fall_check directly from MoveProcessor into FallStepProcessor
-FallStepProcessor::FallStepProcessor(RoomMap* room_map, DeltaFrame* delta_frame, std::vector<GameObject*>&& fall_check):
-fall_comps_unique_ {}, fall_check_ {fall_check}, snake_check_ {},
-map_ {room_map}, delta_frame_ {delta_frame}, layers_fallen_ {} {}
+// Takes the contents of fall_check directly from MoveProcessor, leaving it empty
+FallStepProcessor::FallStepProcessor(RoomMap* room_map, DeltaFrame* delta_frame, std::vector<GameObject*>& fall_check):
+comp_mark_ {component_pool<FallComponent>().mark()},
+fall_comps_ {}, fall_check_ {}, snake_check_ {},
+drop_queue_ {}, comp_columns_ {}, landed_ {},
+map_ {room_map}, delta_frame_ {delta_frame}, layers_fallen_ {} {
+    fall_check_.swap(fall_check);
+}
 
-FallStepProcessor::~FallStepProcessor() {}
+FallStepProcessor::~FallStepProcessor() {
+    component_pool<FallComponent>().release(comp_mark_);
+}
 
 // Returns whether anything falls
 bool FallStepProcessor::run() {
     while (!fall_check_.empty()) {
-        std::vector<GameObject*> next_fall_check {};
+        ScratchVector<GameObject*> next_fall_check {};
         for (GameObject* block : fall_check_) {
             if (!block->fall_comp() && block->tangible_) {
-                auto comp_unique = std::make_unique<FallComponent>();
-                FallComponent* comp = comp_unique.get();
-                fall_comps_unique_.push_back(std::move(comp_unique));
+                FallComponent* comp = component_pool<FallComponent>().acquire();
+                fall_comps_.push_back(comp);
                 block->collect_sticky_component(map_, Sticky::All, comp);
                 collect_above(comp, next_fall_check);
             }
         }
-        fall_check_ = std::move(next_fall_check);
+        fall_check_.swap(next_fall_check);
     }
     // Remove all components which have already landed
-    for (auto& comp : fall_comps_unique_) {
-        check_land_first(comp.get());
+    for (FallComponent* comp : fall_comps_) {
+        check_land_first(comp);
     }
-    fall_comps_unique_.erase(std::remove_if(fall_comps_unique_.begin(), fall_comps_unique_.end(),
-                                            [](auto& comp) { return comp->settled_; }), fall_comps_unique_.end());
-    if (fall_comps_unique_.empty()) {
+    fall_comps_.erase(std::remove_if(fall_comps_.begin(), fall_comps_.end(),
+                                     [](FallComponent* comp) { return comp->settled_; }), fall_comps_.end());
+    if (fall_comps_.empty()) {
         return false;
     }
     // Collect all falling snakes, and their adjacent maybe-confused snakes
-    for (auto& comp : fall_comps_unique_) {
+    for (FallComponent* comp : fall_comps_) {
         for (GameObject* block : comp->blocks_) {
-            if (SnakeBlock* sb = dynamic_cast<SnakeBlock*>(block)) {
-                snake_check_.insert(sb);
+            if (SnakeBlock* sb = kind_cast<SnakeBlock>(block)) {
+                push_unique(snake_check_, sb);
                 sb->collect_maybe_confused_neighbors(map_, snake_check_);
             }
         }
     }
-    for (auto& comp : fall_comps_unique_) {
+    for (FallComponent* comp : fall_comps_) {
         comp->take_falling(map_);
     }
-    layers_fallen_ = 0;
-    while (true) {
-        ++layers_fallen_;
-        bool done_falling = true;
-        for (auto& comp : fall_comps_unique_) {
-            if (drop_check(comp.get())) {
-                done_falling = false;
-            }
+    // Everything falls at the same speed, so the only way one falling
+    // component can get in another's way is by landing first.  So find
+    // where each would land if nothing else moved, then land them in
+    // order (ties going in fall_comps_ order, as if they fell together
+    // one layer at a time), updating only the components next to each
+    // one that lands.
+    layers_fallen_ = 1;
+    for (int i = 0; i < (int)fall_comps_.size(); ++i) {
+        FallComponent* comp = fall_comps_[i];
+        find_drop(comp);
+        drop_queue_.push_back({comp->drop_, i});
+        for (Point3 pos : comp->positions_) {
+            comp_columns_.push_back({column_key(pos), i});
         }
-        if (done_falling) {
-            break;
+    }
+    std::make_heap(drop_queue_.begin(), drop_queue_.end(), std::greater<std::pair<int, int>>());
+    std::sort(comp_columns_.begin(), comp_columns_.end());
+    while (!drop_queue_.empty()) {
+        std::pop_heap(drop_queue_.begin(), drop_queue_.end(), std::greater<std::pair<int, int>>());
+        std::pair<int, int> next = drop_queue_.back();
+        drop_queue_.pop_back();
+        FallComponent* comp = fall_comps_[next.second];
+        // Skip entries left behind when a component's drop got shorter
+        if (comp->settled_ || next.first != comp->drop_) {
+            continue;
         }
-        for (auto& comp : fall_comps_unique_) {
-            if (!comp->settled_) {
-                check_land_sticky(comp.get());
-            }
+        layers_fallen_ = comp->drop_;
+        if (!lands(comp)) {
+            handle_fallen_blocks(comp);
+            continue;
+        }
+        settle(comp);
+        for (FallComponent* landed : landed_) {
+            recheck_near(landed);
         }
+        landed_.clear();
     }
     for (SnakeBlock* snake : snake_check_) {
         snake->check_add_local_links(map_, delta_frame_);
     }
+    // Whatever rested on the blocks that fell was part of this fall
+    map_->forget_support_changes();
     return true;
 }
 
@@ -86,7 +114,7 @@ void FallStepProcessor::collect_above(FallComponent* comp, std::vector<GameObjec
 }
 
 void FallStepProcessor::check_land_first(FallComponent* comp) {
-    std::vector<FallComponent*> comps_below;
+    ScratchVector<FallComponent*> comps_below {};
     for (GameObject* block : comp->blocks_) {
         if (!block->gravitable_) {
             comp->settle_first();
@@ -110,40 +138,97 @@ void FallStepProcessor::check_land_first(FallComponent* comp) {
     }
 }
 
-// Returns whether the component is "still falling" (false if stopped or reached oblivion)
-bool FallStepProcessor::drop_check(FallComponent* comp) {
-    if (comp->settled_) {
-        return false;
-    }
-    bool alive = false;
-    for (GameObject* block : comp->blocks_) {
-        block->pos_ += {0,0,-1};
-        if (block->pos_.z >= 0) {
-            alive = true;
+// Lowers comp->drop_ to the first layer at which one of comp's blocks
+// would rest on something, or be next to something it sticks to.
+// Only layers_fallen_ and later are considered, and things are only ever
+// added to the map while falling, so earlier results never get longer.
+void FallStepProcessor::find_drop(FallComponent* comp) {
+    GameObjectArray& objs = map_->obj_array_;
+    for (unsigned int i = 0; i < comp->positions_.size(); ++i) {
+        Point3 pos = comp->positions_[i];
+        int below = map_->highest_below(pos - Point3{0,0,layers_fallen_});
+        if (below >= 0) {
+            comp->drop_ = std::min(comp->drop_, pos.z - below - 1);
+        }
+        GameObject* block = comp->blocks_[i];
+        Sticky sticky = block->sticky();
+        if (sticky == Sticky::None) {
+            continue;
+        }
+        for (Point3 d : H_DIRECTIONS) {
+            Point3 adj = pos + d;
+            // Out of bounds is all Wall, which never sticks
+            if (!map_->valid(adj)) {
+                continue;
+            }
+            // Visit occupied cells beside the block's path, from the top
+            for (adj.z = map_->highest_below(adj - Point3{0,0,layers_fallen_ - 1});
+                 adj.z >= 0 && pos.z - adj.z < comp->drop_;
+                 adj.z = map_->highest_below(adj)) {
+                GameObject* adj_obj = objs[map_->id_at(adj)];
+                if (adj_obj->color_ == block->color_ &&
+                    static_cast<bool>(adj_obj->sticky() & sticky)) {
+                    comp->drop_ = pos.z - adj.z;
+                    break;
+                }
+            }
         }
     }
-    if (!alive) {
-        handle_fallen_blocks(comp);
-    }
-    return alive;
 }
 
-void FallStepProcessor::check_land_sticky(FallComponent* comp) {
-    for (GameObject* block : comp->blocks_) {
-        if (block->pos_.z < 0) {
+int FallStepProcessor::column_key(Point3 pos) {
+    return pos.x + map_->width_*pos.y;
+}
+
+// Finds new drops for the falling components whose blocks are in or beside
+// the columns of a component that just landed, since they're the only ones
+// which could now land on it or stick to it sooner
+void FallStepProcessor::recheck_near(FallComponent* landed) {
+    for (Point3 pos : landed->positions_) {
+        if (pos.z < 0) {
             continue;
         }
-        if (map_->view(block->shifted_pos({0,0,-1})) || block->has_sticky_neighbor(map_)) {
-            settle(comp);
-            return;
+        for (Point3 d : {Point3{0,0,0}, Point3{1,0,0}, Point3{-1,0,0}, Point3{0,1,0}, Point3{0,-1,0}}) {
+            Point3 col = pos + d;
+            if (!map_->valid(col)) {
+                continue;
+            }
+            int key = column_key(col);
+            for (auto it = std::lower_bound(comp_columns_.begin(), comp_columns_.end(), std::make_pair(key, -1));
+                 it != comp_columns_.end() && it->first == key; ++it) {
+                FallComponent* comp = fall_comps_[it->second];
+                if (comp->settled_) {
+                    continue;
+                }
+                int old_drop = comp->drop_;
+                find_drop(comp);
+                if (comp->drop_ < old_drop) {
+                    drop_queue_.push_back({comp->drop_, it->second});
+                    std::push_heap(drop_queue_.begin(), drop_queue_.end(), std::greater<std::pair<int, int>>());
+                }
+            }
+        }
+    }
+}
+
+// Whether any of comp's blocks are still in the map after it falls
+bool FallStepProcessor::lands(FallComponent* comp) {
+    for (Point3 pos : comp->positions_) {
+        if (pos.z >= comp->drop_) {
+            return true;
         }
     }
+    return false;
 }
 
 // TODO: Check snake links post-fall!!
 void FallStepProcessor::handle_fallen_blocks(FallComponent* comp) {
     comp->settled_ = true;
-    std::vector<GameObject*> live_blocks {};
+    for (Point3& pos : comp->positions_) {
+        pos.z -= layers_fallen_;
+    }
+    comp->update_positions();
+    ScratchVector<GameObject*> live_blocks {};
     for (GameObject* block : comp->blocks_) {
         if (block->pos_.z >= 0) {
             // TODO: put the responsibility of making fall trails in a better place
@@ -156,13 +241,16 @@ void FallStepProcessor::handle_fallen_blocks(FallComponent* comp) {
             block->pos_ += {0,0,layers_fallen_};
             map_->just_put(block);
             map_->destroy(block, delta_frame_);
-            if (SnakeBlock* sb = dynamic_cast<SnakeBlock*>(block)) {
-                snake_check_.erase(sb);
+            if (SnakeBlock* sb = kind_cast<SnakeBlock>(block)) {
+                snake_check_.erase(std::remove(snake_check_.begin(), snake_check_.end(), sb), snake_check_.end());
             }
         }
     }
+    if (!live_blocks.empty()) {
+        landed_.push_back(comp);
+    }
     if (!live_blocks.empty() && delta_frame_) {
-        delta_frame_->push(std::make_unique<BatchMotionDelta>(std::move(live_blocks), Point3{0,0,-layers_fallen_}, map_));
+        delta_frame_->push(std::make_unique<BatchMotionDelta>(live_blocks, Point3{0,0,-layers_fallen_}, map_));
     }
 }
 
@@ -170,7 +258,7 @@ void FallStepProcessor::settle(FallComponent* comp) {
     handle_fallen_blocks(comp);
     for (FallComponent* above : comp->above_) {
         if (!above->settled_) {
-            settle(comp);
+            settle(above);
         }
     }
 }
@@ -10,6 +10,7 @@
 #include "animation.h"
 
 #include "component.h"
+#include "movearena.h"
 
 
 Sticky operator &(Sticky a, Sticky b) {
@@ -19,19 +20,20 @@ Sticky operator &(Sticky a, Sticky b) {
 
 
 // id_ begins in an "inconsistent" state - it *must* be set by the GameObjectArray
-GameObject::GameObject(Point3 pos, int color, bool pushable, bool gravitable):
+GameObject::GameObject(ObjCode kind, Point3 pos, int color, bool pushable, bool gravitable):
     modifier_ {}, animation_ {}, comp_ {},
-    pos_ {pos}, id_ {-1},
+    pos_ {pos}, id_ {-1}, gen_ {0},
     color_ {color}, pushable_ {pushable}, gravitable_ {gravitable},
-    tangible_ {false} {}
+    tangible_ {false}, agent_slot_ {-1}, gravitable_slot_ {-1}, kind_ {kind} {}
 
 GameObject::~GameObject() {}
 
 // Copy Constructor creates trivial unique_ptr members
 GameObject::GameObject(const GameObject& obj):
     modifier_ {}, animation_ {}, comp_ {},
-    pos_ {obj.pos_}, id_ {-1},
-    color_ {obj.color_}, pushable_ {obj.pushable_}, gravitable_ {obj.gravitable_} {}
+    pos_ {obj.pos_}, id_ {-1}, gen_ {0},
+    color_ {obj.color_}, pushable_ {obj.pushable_}, gravitable_ {obj.gravitable_},
+    tangible_ {false}, agent_slot_ {-1}, gravitable_slot_ {-1}, kind_ {obj.kind_} {}
 
 std::string GameObject::to_str() {
     std::string mod_str {""};
@@ -53,33 +55,23 @@ bool GameObject::skip_serialization() {
     return false;
 }
 
-void GameObject::relation_serialize(MapFileO& file) {}
+void GameObject::relation_serialize(MapFileO& file, GameObjectArray&) {}
 
 bool GameObject::is_agent() {
     return (modifier_ && modifier()->is_agent());
 }
 
+GameObjectHandle GameObject::handle() {
+    return {id_, gen_};
+}
+
 Point3 GameObject::shifted_pos(Point3 d) {
     return pos_ + d;
 }
 
+// Modifiers with positions of their own are shifted separately, by kind
 void GameObject::shift_internal_pos(Point3 d) {
     pos_ += d;
-    if (modifier_) {
-        modifier_->shift_internal_pos(d);
-    }
-}
-
-void GameObject::setup_on_put(RoomMap* room_map) {
-    if (modifier_) {
-        modifier_->setup_on_put(room_map);
-    }
-}
-
-void GameObject::cleanup_on_take(RoomMap* room_map) {
-    if (modifier_) {
-        modifier_->cleanup_on_take(room_map);
-    }
 }
 
 void GameObject::cleanup_on_destruction(RoomMap* room_map) {
@@ -104,28 +96,40 @@ ObjectModifier* GameObject::modifier() {
 
 // NOTE: these can be static_casts as long as the code using them is careful
 PushComponent* GameObject::push_comp() {
-    return dynamic_cast<PushComponent*>(comp_);
+    if (comp_ && !comp_->falling_) {
+        return static_cast<PushComponent*>(comp_);
+    }
+    return nullptr;
 }
 
 FallComponent* GameObject::fall_comp() {
-    return dynamic_cast<FallComponent*>(comp_);
+    if (comp_ && comp_->falling_) {
+        return static_cast<FallComponent*>(comp_);
+    }
+    return nullptr;
 }
 
 
 void GameObject::collect_sticky_component(RoomMap* room_map, Sticky sticky_level, Component* comp) {
-    std::vector<GameObject*> to_check {this};
+    ScratchVector<GameObject*> to_check {};
+    to_check.push_back(this);
     while (!to_check.empty()) {
         GameObject* cur = to_check.back();
         to_check.pop_back();
         if (cur->comp_) {
             continue;
         }
-        cur->comp_ = comp;
-        comp->blocks_.push_back(cur);
-        cur->collect_sticky_links(room_map, sticky_level, to_check);
-        cur->collect_special_links(room_map, sticky_level, to_check);
-        if (ObjectModifier* mod = cur->modifier()) {
-            mod->collect_sticky_links(room_map, sticky_level, to_check);
+        // cur's sticky group joins all at once; only one-way links need following
+        for (GameObject* member : room_map->sticky_group(cur, sticky_level)) {
+            if (member->comp_) {
+                continue;
+            }
+            member->comp_ = comp;
+            comp->blocks_.push_back(member);
+            member->collect_special_links(room_map, sticky_level, to_check);
+            if (ObjectModifier* mod = member->modifier()) {
+                mod->collect_sticky_links(room_map, sticky_level, to_check);
+            }
         }
     }
 }
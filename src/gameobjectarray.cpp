@@ -4,17 +4,27 @@
 #include "objectmodifier.h"
 #include "animation.h"
 
-GameObjectArray::GameObjectArray(): array_ {} {
+GameObjectArray::GameObjectArray(): array_ {}, generations_ {}, free_ids_ {} {
     array_.push_back(nullptr);
     array_.push_back(std::make_unique<Wall>());
     array_[1]->id_ = 1;
+    generations_.resize(2, 0);
 }
 
 GameObjectArray::~GameObjectArray() {}
 
 void GameObjectArray::push_object(std::unique_ptr<GameObject> obj) {
-    obj->id_ = array_.size();
-    array_.push_back(std::move(obj));
+    GameObject* raw = obj.get();
+    if (free_ids_.empty()) {
+        obj->id_ = array_.size();
+        array_.push_back(std::move(obj));
+        generations_.push_back(0);
+    } else {
+        obj->id_ = free_ids_.top();
+        free_ids_.pop();
+        array_[obj->id_] = std::move(obj);
+    }
+    raw->gen_ = generations_[raw->id_];
 }
 
 GameObject* GameObjectArray::operator[](int id) const {
@@ -29,7 +39,21 @@ GameObject* GameObjectArray::safe_get(int id) const {
     }
 }
 
-// TODO: use a minheap of "deleted IDs" to potentially reuse object IDs.
+// Only free an object once nothing (including the undo stack) can refer to it
 void GameObjectArray::destroy(GameObject* obj) {
-    array_[obj->id_].reset(nullptr);
+    int id = obj->id_;
+    array_[id].reset(nullptr);
+    ++generations_[id];
+    free_ids_.push(id);
+}
+
+GameObject* GameObjectArray::get(GameObjectHandle h) const {
+    if (generations_[h.id] != h.gen) {
+        return nullptr;
+    }
+    return array_[h.id].get();
+}
+
+unsigned int GameObjectArray::size() const {
+    return array_.size();
 }
@@ -1,5 +1,6 @@
 #include "gate.h"
 
+#include "slab.h"
 #include "point.h"
 #include <memory>
 #include "gatebody.h"
@@ -10,11 +11,19 @@
 #include "graphicsmanager.h"
 
 // Gates should be initialized down in case they are "covered" at load time
-Gate::Gate(GameObject* parent, GateBody* body, int color, bool def, bool active, bool waiting):
-Switchable(parent, def, active, waiting), color_ {color}, body_ {body} {}
+Gate::Gate(GameObject* parent, int color, bool def, bool active, bool waiting):
+Switchable(parent, ModCode::Gate, def, active, waiting), color_ {color}, body_ {} {}
 
 Gate::~Gate() {}
 
+void* Gate::operator new(std::size_t size) {
+    return slab_new<Gate>(size);
+}
+
+void Gate::operator delete(void* block, std::size_t size) {
+    slab_delete<Gate>(block, size);
+}
+
 std::string Gate::name() {
     return "Gate";
 }
@@ -23,63 +32,68 @@ ModCode Gate::mod_code() {
     return ModCode::Gate;
 }
 
-void Gate::serialize(MapFileO& file) {
-    bool body_alive = (body_ != nullptr);
+void Gate::serialize(MapFileO& file, GameObjectArray& objs) {
+    GameObject* body = objs.get(body_);
+    bool body_alive = (body != nullptr);
     file << color_ << default_ << active_ << waiting_ << body_alive;
     if (body_alive) {
-        file << Point3_S16{body_->pos_ - pos()};
+        file << Point3_S16{body->pos_ - pos()};
     }
 }
 
 void Gate::deserialize(MapFileI& file, RoomMap* room_map, GameObject* parent) {
     unsigned char b[5];
     file.read(b, 5);
-    auto gate = std::make_unique<Gate>(parent, nullptr, b[0], b[1], b[2], b[3]);
+    auto gate = std::make_unique<Gate>(parent, b[0], b[1], b[2], b[3]);
     // Is the body alive?
     if (b[4]) {
         Point3_S16 body_pos {};
         file >> body_pos;
         auto gate_body_unique = std::make_unique<GateBody>(gate.get(), Point3{body_pos} + parent->pos_);
-        gate->body_ = gate_body_unique.get();
+        GateBody* body = gate_body_unique.get();
         room_map->create_abstract(std::move(gate_body_unique), nullptr);
+        gate->body_ = body->handle();
     }
-    parent->set_modifier(std::move(gate));
+    room_map->set_modifier(parent, std::move(gate));
 }
 
-void Gate::shift_internal_pos(Point3 d) {
-    if ((body_ != nullptr) && !state()) {
-        body_->shift_internal_pos(d);
+GateBody* Gate::body(RoomMap* room_map) {
+    return static_cast<GateBody*>(room_map->obj_array_.get(body_));
+}
+
+void Gate::shift_internal_pos(RoomMap* room_map, Point3 d) {
+    GateBody* gate_body = body(room_map);
+    if (gate_body && !state()) {
+        gate_body->shift_internal_pos(d);
     }
 }
 
-void Gate::collect_sticky_links(RoomMap*, Sticky, std::vector<GameObject*>& to_check) {
-    if (body_ && state()) {
-        to_check.push_back(body_);
+void Gate::collect_sticky_links(RoomMap* room_map, Sticky, std::vector<GameObject*>& to_check) {
+    GateBody* gate_body = body(room_map);
+    if (gate_body && state()) {
+        to_check.push_back(gate_body);
     }
 }
 
 bool Gate::can_set_state(bool state, RoomMap* room_map) {
-    return body_ && (!state || (room_map->view(body_->pos_) == nullptr));
+    GateBody* gate_body = body(room_map);
+    return gate_body && (!state || (room_map->view(gate_body->pos_) == nullptr));
 }
 
 void Gate::apply_state_change(RoomMap* room_map, DeltaFrame* delta_frame, MoveProcessor* mp) {
-    if (body_) {
-        mp->add_gate_transition(body_, state());
+    if (GateBody* gate_body = body(room_map)) {
+        mp->add_gate_transition(gate_body, state());
         if (state()) {
-            room_map->put_loud(body_, delta_frame);
-        }
-        GameObject* above = room_map->view(body_->pos_ + Point3{0,0,1});
-        if (above && above->gravitable_) {
-            mp->add_to_fall_check(above);
+            room_map->put_loud(gate_body, delta_frame);
         }
     }
 }
 
 void Gate::map_callback(RoomMap* room_map, DeltaFrame* delta_frame, MoveProcessor* mp) {
-    if (body_) {
-        Point3 dpos = body_->update_gate_pos(delta_frame);
+    if (GateBody* gate_body = body(room_map)) {
+        Point3 dpos = gate_body->update_gate_pos(this, delta_frame);
         if (!state()) {
-            body_->abstract_shift(dpos, delta_frame);
+            gate_body->abstract_shift(dpos, delta_frame);
         }
     }
     check_waiting(room_map, delta_frame, mp);
@@ -88,15 +102,30 @@ void Gate::map_callback(RoomMap* room_map, DeltaFrame* delta_frame, MoveProcesso
 // TODO: make sure Gate listeners are handled correctly in all cases
 // Could disable listener creation when the gate is retracted, too.
 void Gate::setup_on_put(RoomMap* room_map) {
-    if (body_) {
-        room_map->add_listener(this, body_->pos_);
+    if (GateBody* gate_body = body(room_map)) {
+        room_map->add_listener(this, gate_body->pos_);
         room_map->activate_listener_of(this);
     }
 }
 
 void Gate::cleanup_on_take(RoomMap* room_map) {
-    if (body_) {
-        room_map->remove_listener(this, body_->pos_);
+    if (body(room_map)) {
+        room_map->remove_listener(this);
+    }
+}
+
+// A destroyed Gate leaves its body orphaned, since the Gate may be freed
+void Gate::cleanup_on_destruction(RoomMap* room_map) {
+    Switchable::cleanup_on_destruction(room_map);
+    if (GateBody* gate_body = body(room_map)) {
+        gate_body->gate_ = {};
+    }
+}
+
+void Gate::setup_on_undestruction(RoomMap* room_map) {
+    Switchable::setup_on_undestruction(room_map);
+    if (GateBody* gate_body = body(room_map)) {
+        gate_body->gate_ = parent_->handle();
     }
 }
 
@@ -114,15 +143,16 @@ void Gate::draw(GraphicsManager* gfx, FPoint3 p) {
 std::unique_ptr<ObjectModifier> Gate::duplicate(GameObject* parent, RoomMap* room_map, DeltaFrame* delta_frame) {
     auto dup = std::make_unique<Gate>(*this);
     dup->parent_ = parent;
-    if (body_) {
-        auto body_dup = std::make_unique<GateBody>(*body_);
+    if (GateBody* gate_body = body(room_map)) {
+        auto body_dup_unique = std::make_unique<GateBody>(*gate_body);
+        GateBody* body_dup = body_dup_unique.get();
         body_dup->set_gate(dup.get());
-        dup->body_ = body_dup.get();
         if (state()) {
-            room_map->create(std::move(body_dup), delta_frame);
+            room_map->create(std::move(body_dup_unique), delta_frame);
         } else {
-            room_map->create_abstract(std::move(body_dup), delta_frame);
+            room_map->create_abstract(std::move(body_dup_unique), delta_frame);
         }
+        dup->body_ = body_dup->handle();
     }
     dup->connect_to_signalers();
     return std::move(dup);
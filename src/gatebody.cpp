@@ -1,5 +1,6 @@
 #include "gatebody.h"
 
+#include "slab.h"
 
 #include "point.h"
 #include "gate.h"
@@ -10,22 +11,32 @@
 #include "animation.h"
 
 #include "delta.h"
+#include "roommap.h"
 
 GateBody::GateBody(Gate* gate, Point3 pos):
-PushBlock(pos, gate->color_, gate->pushable(), gate->gravitable(), Sticky::None),
+PushBlock(ObjCode::GateBody, pos, gate->color_, gate->pushable(), gate->gravitable(), Sticky::None),
 gate_ {}, gate_pos_ {}, transition_animation_ {} {
     set_gate(gate);
 }
 
 // For orphaned GateBodies
 GateBody::GateBody(Point3 pos, int color, bool pushable, bool gravitable):
-PushBlock(pos, color, pushable, gravitable, Sticky::None),
+PushBlock(ObjCode::GateBody, pos, color, pushable, gravitable, Sticky::None),
 gate_ {}, gate_pos_ {}, transition_animation_ {} {}
 
-GateBody::GateBody(const GateBody& other): PushBlock(other), transition_animation_ {} {}
+GateBody::GateBody(const GateBody& other): PushBlock(other),
+gate_ {other.gate_}, gate_pos_ {other.gate_pos_}, transition_animation_ {} {}
 
 GateBody::~GateBody() {}
 
+void* GateBody::operator new(std::size_t size) {
+    return slab_new<GateBody>(size);
+}
+
+void GateBody::operator delete(void* block, std::size_t size) {
+    slab_delete<GateBody>(block, size);
+}
+
 std::string GateBody::name() {
     return "GateBody";
 }
@@ -36,7 +47,7 @@ ObjCode GateBody::obj_code() {
 
 // Orphaned GateBodies need to be serialized!
 bool GateBody::skip_serialization() {
-    return gate_ != nullptr;
+    return gate_.id != 0;
 }
 
 void GateBody::serialize(MapFileO& file) {
@@ -54,30 +65,47 @@ Point3 GateBody::gate_pos() {
     return gate_pos_;
 }
 
+// The Gate's parent must already have an id
 void GateBody::set_gate(Gate* gate) {
-    gate_ = gate;
+    gate_ = gate->parent_->handle();
     gate_pos_ = gate->pos();
 }
 
-Point3 GateBody::update_gate_pos(DeltaFrame* delta_frame) {
-    Point3 dpos = gate_->pos() - gate_pos_;
+Point3 GateBody::update_gate_pos(Gate* gate, DeltaFrame* delta_frame) {
+    Point3 dpos = gate->pos() - gate_pos_;
     if (!(dpos == Point3{})) {
         delta_frame->push(std::make_unique<GatePosDelta>(this, dpos));
-        gate_pos_ = gate_->pos();
+        gate_pos_ = gate->pos();
     }
     return dpos;
 }
 
-void GateBody::collect_special_links(RoomMap*, Sticky, std::vector<GameObject*>& to_check) {
-    if (gate_) {
-        to_check.push_back(gate_->parent_);
+void GateBody::collect_special_links(RoomMap* room_map, Sticky, std::vector<GameObject*>& to_check) {
+    if (GameObject* gate_parent = room_map->obj_array_.get(gate_)) {
+        to_check.push_back(gate_parent);
+    }
+}
+
+// Likewise, the Gate forgets a destroyed body
+void GateBody::cleanup_on_destruction(RoomMap* room_map) {
+    PushBlock::cleanup_on_destruction(room_map);
+    if (GameObject* gate_parent = room_map->obj_array_.get(gate_)) {
+        static_cast<Gate*>(gate_parent->modifier())->body_ = {};
+    }
+}
+
+void GateBody::setup_on_undestruction(RoomMap* room_map) {
+    PushBlock::setup_on_undestruction(room_map);
+    if (GameObject* gate_parent = room_map->obj_array_.get(gate_)) {
+        static_cast<Gate*>(gate_parent->modifier())->body_ = handle();
     }
 }
 
-void GateBody::set_gate_transition_animation(bool state, MoveProcessor* mp) {
+void GateBody::set_gate_transition_animation(bool state, RoomMap* room_map, MoveProcessor* mp) {
     transition_animation_ = std::make_unique<GateTransitionAnimation>(state);
-    if (gate_ && state) {
-        if (PositionalAnimation* anim = gate_->parent_->animation_.get()) {
+    GameObject* gate_parent = room_map->obj_array_.get(gate_);
+    if (gate_parent && state) {
+        if (PositionalAnimation* anim = gate_parent->animation_.get()) {
             animation_ = anim->duplicate();
             mp->add_to_moving_blocks(this);
         }
@@ -6,18 +6,20 @@
 
 HorizontalStepProcessor::HorizontalStepProcessor(RoomMap* room_map, DeltaFrame* delta_frame, Point3 dir,
     std::vector<GameObject*>& fall_check, std::vector<GameObject*>& moving_blocks):
-push_comps_unique_ {},
+comp_mark_ {component_pool<PushComponent>().mark()},
 moving_snakes_ {}, snakes_to_recheck_ {},
 fall_check_ {fall_check}, moving_blocks_ {moving_blocks},
 map_ {room_map}, delta_frame_ {delta_frame}, dir_ {dir} {}
 
-HorizontalStepProcessor::~HorizontalStepProcessor() {}
+HorizontalStepProcessor::~HorizontalStepProcessor() {
+    component_pool<PushComponent>().release(comp_mark_);
+}
 
 
 void HorizontalStepProcessor::run() {
-    for (GameObject* agent : map_->agents_) {
+    map_->agents_.for_each([this](GameObject* agent) {
         compute_push_component_tree(agent);
-    }
+    });
     // TODO: make this code more general if Puppets exist (i.e. dependent agents)
     if (!moving_blocks_.empty()) {
         perform_horizontal_step();
@@ -27,93 +29,234 @@ void HorizontalStepProcessor::run() {
 
 // Try to push the block and build the resulting component tree
 // Return whether block is able to move
-bool HorizontalStepProcessor::compute_push_component_tree(GameObject* block) {
-    snakes_to_recheck_ = {};
-    if (!compute_push_component(block)) {
-        return false;
-    }
-    std::vector<GameObject*> weak_links {};
-    // Ensures that snakes which were "pushed late" still drag their links
-    for (auto snake : snakes_to_recheck_) {
-        snake->dragged_ = false;
-        snake->collect_dragged_snake_links(map_, dir_, weak_links);
-    }
-    collect_moving_and_weak_links(block->push_comp(), weak_links);
-    for (auto link : weak_links) {
-        if (!compute_push_component_tree(link)) {
-            if (auto sb = dynamic_cast<SnakeBlock*>(link)) {
+// Each weak link gets its own tree, depth first and in the order the links
+// were found, but with the pending links kept in one list rather than on
+// the call stack: a tree's links sit above those of the tree that found it.
+bool HorizontalStepProcessor::compute_push_component_tree(GameObject* start_block) {
+    struct TreeFrame {
+        // The tree's weak links are weak_links[begin, end), next is the next to try
+        unsigned int begin;
+        unsigned int next;
+        unsigned int end;
+    };
+    ScratchVector<GameObject*> weak_links {};
+    ScratchVector<TreeFrame> frames {};
+    bool start_moves = false;
+    GameObject* block = start_block;
+    while (true) {
+        snakes_to_recheck_.clear();
+        bool moves = compute_push_component(block);
+        if (frames.empty()) {
+            // Only the starting block is tried with no tree above it
+            start_moves = moves;
+        } else if (!moves) {
+            if (auto sb = kind_cast<SnakeBlock>(block)) {
                 sb->dragged_ = false;
             }
         }
+        if (moves) {
+            unsigned int begin = weak_links.size();
+            // Ensures that snakes which were "pushed late" still drag their links
+            for (auto snake : snakes_to_recheck_) {
+                snake->dragged_ = false;
+                snake->collect_dragged_snake_links(map_, dir_, weak_links);
+            }
+            collect_moving_and_weak_links(block->push_comp(), weak_links);
+            frames.push_back({begin, begin, (unsigned int)weak_links.size()});
+        }
+        // Find the next link to try, finishing any trees that are out of links
+        while (!frames.empty() && frames.back().next == frames.back().end) {
+            weak_links.resize(frames.back().begin);
+            frames.pop_back();
+        }
+        if (frames.empty()) {
+            break;
+        }
+        block = weak_links[frames.back().next++];
     }
-    return true;
+    return start_moves;
+}
+
+// Whether block's push component is just block itself: a plain PushBlock,
+// with no modifier to link it to anything, which doesn't stick strongly
+static bool is_lone_block(GameObject* block) {
+    return block->kind_ == ObjCode::PushBlock && !block->modifier() &&
+        (block->sticky() & Sticky::Strong) == Sticky::None;
 }
 
 // Try to push the component containing block
 // Return whether block is able to move
+// Pushing a component means first pushing each component in front of it,
+// which is done with an explicit stack of components still being worked on
+// (rather than recursion), so that a long train of blocks takes one pass
+// along it and no more stack than a short one.  A component in front which
+// is still on the stack (because the pushes went around in a loop) counts
+// as movable, as it's not known to be blocked.
 bool HorizontalStepProcessor::compute_push_component(GameObject* start_block) {
     if (PushComponent* comp = start_block->push_comp()) {
         return !comp->blocked_;
     }
-    auto comp_unique = std::make_unique<PushComponent>();
-    PushComponent* comp = comp_unique.get();
-    push_comps_unique_.push_back(std::move(comp_unique));
-    start_block->collect_sticky_component(map_, Sticky::Strong, comp);
-    for (auto block : comp->blocks_) {
-        if (!block->pushable_) {
-            comp->blocked_ = true;
-            break;
+    struct PushFrame {
+        PushComponent* comp;
+        // The index of the next block of comp to look in front of
+        unsigned int next;
+    };
+    ScratchVector<PushFrame> frames {};
+    ScratchVector<PushComponent*> run {};
+    PushComponent* start_comp = component_pool<PushComponent>().acquire();
+    start_block->collect_sticky_component(map_, Sticky::Strong, start_comp);
+    frames.push_back({start_comp, 0});
+    while (!frames.empty()) {
+        PushComponent* comp = frames.back().comp;
+        GameObject* unresolved = nullptr;
+        while (!comp->blocked_ && frames.back().next < comp->blocks_.size()) {
+            GameObject* block = comp->blocks_[frames.back().next];
+            if (!block->pushable_) {
+                comp->blocked_ = true;
+                break;
+            }
+            GameObject* in_front = map_->view(block->pos_ + dir_);
+            if (!in_front) {
+                ++frames.back().next;
+                continue;
+            }
+            if (!in_front->pushable_) {
+                // The thing we tried to push wasn't pushable
+                comp->blocked_ = true;
+                break;
+            }
+            if (auto sb = kind_cast<SnakeBlock>(in_front)) {
+                snakes_to_recheck_.push_back(sb);
+            }
+            PushComponent* comp_in_front = in_front->push_comp();
+            if (!comp_in_front) {
+                unresolved = in_front;
+                break;
+            }
+            if (comp_in_front->blocked_) {
+                // The thing we tried to push couldn't move
+                comp->blocked_ = true;
+                break;
+            }
+            comp->add_pushing(comp_in_front);
+            ++frames.back().next;
         }
-        if (GameObject* in_front = map_->view(block->pos_ + dir_)) {
-            if (in_front->pushable_) {
-                if (auto sb = dynamic_cast<SnakeBlock*>(in_front)) {
-                    snakes_to_recheck_.push_back(sb);
-                }
-                if (compute_push_component(in_front)) {
-                    comp->add_pushing(in_front->push_comp());
-                } else {
-                    // The thing we tried to push couldn't move
+        if (unresolved && is_lone_block(unresolved)) {
+            if (push_straight_run(unresolved, run)) {
+                // The run resolved itself; pick up after the block pushing it
+                if (run.front()->blocked_) {
                     comp->blocked_ = true;
-                    break;
+                } else {
+                    comp->add_pushing(run.front());
+                    ++frames.back().next;
                 }
             } else {
-                // The thing we tried to push wasn't pushable
-                comp->blocked_ = true;
-                break;
+                // The run ended at something which needs the general treatment,
+                // so it goes on the stack like any other chain of components
+                for (PushComponent* run_comp : run) {
+                    frames.push_back({run_comp, 0});
+                }
+            }
+            continue;
+        }
+        if (unresolved) {
+            // Work out the component in front first, then come back to this block
+            PushComponent* comp_in_front = component_pool<PushComponent>().acquire();
+            unresolved->collect_sticky_component(map_, Sticky::Strong, comp_in_front);
+            frames.push_back({comp_in_front, 0});
+            continue;
+        }
+        // comp is done; the component behind it picks up after the block
+        // which was pushing it
+        frames.pop_back();
+        if (!frames.empty()) {
+            PushFrame& behind = frames.back();
+            if (comp->blocked_) {
+                // The thing we tried to push couldn't move
+                behind.comp->blocked_ = true;
+            } else {
+                behind.comp->add_pushing(comp);
+                ++behind.next;
             }
         }
     }
-    return !comp->blocked_;
+    return !start_comp->blocked_;
 }
 
-
-void HorizontalStepProcessor::collect_moving_and_weak_links(PushComponent* comp, std::vector<GameObject*>& weak_links) {
-    if (comp->moving_) {
-        return;
-    }
-    comp->moving_ = true;
-    for (GameObject* block : comp->blocks_) {
-        moving_blocks_.push_back(block);
-        if (SnakeBlock* sb = dynamic_cast<SnakeBlock*>(block)) {
-            moving_snakes_.push_back(sb);
-            if (!sb->dragged_) {
-                sb->collect_dragged_snake_links(map_, dir_, weak_links);
+// The common case of a straight train of lone blocks, walked in one loop
+// rather than one stack frame per block.  Each block of the run (starting
+// from first, which has no component yet) gets a component of its own, in
+// run, front last.  If the run ends at empty space or at something that
+// can't be pushed, resolve the whole run and return true.  Otherwise the
+// last component in run still has to look in front of its block, so
+// return false and leave the run unresolved.
+bool HorizontalStepProcessor::push_straight_run(GameObject* first, std::vector<PushComponent*>& run) {
+    run.clear();
+    GameObject* block = first;
+    while (true) {
+        PushComponent* comp = component_pool<PushComponent>().acquire();
+        // What collect_sticky_component would do for a lone block
+        block->comp_ = comp;
+        comp->blocks_.push_back(block);
+        run.push_back(comp);
+        GameObject* in_front = map_->view(block->pos_ + dir_);
+        if (in_front && in_front->pushable_ && !in_front->push_comp() && is_lone_block(in_front)) {
+            block = in_front;
+            continue;
+        }
+        if (in_front && in_front->pushable_) {
+            return false;
+        }
+        // The run moves unless the thing at the front wasn't pushable
+        bool blocked = (in_front != nullptr);
+        for (unsigned int i = static_cast<unsigned int>(run.size()); i-- > 0;) {
+            if (blocked) {
+                run[i]->blocked_ = true;
+            } else if (i + 1 < run.size()) {
+                run[i]->add_pushing(run[i + 1]);
             }
         }
-        block->collect_sticky_links(map_, Sticky::Weak, weak_links);
+        return true;
     }
-    for (PushComponent* in_front : comp->pushing_) {
-        collect_moving_and_weak_links(in_front, weak_links);
+}
+
+// Every component pushed by comp moves along with it, visited depth first
+// (through the pushing_ lists, in order) using an explicit stack
+void HorizontalStepProcessor::collect_moving_and_weak_links(PushComponent* start_comp, std::vector<GameObject*>& weak_links) {
+    ScratchVector<PushComponent*> to_visit {};
+    to_visit.push_back(start_comp);
+    while (!to_visit.empty()) {
+        PushComponent* comp = to_visit.back();
+        to_visit.pop_back();
+        if (comp->moving_) {
+            continue;
+        }
+        comp->moving_ = true;
+        for (GameObject* block : comp->blocks_) {
+            moving_blocks_.push_back(block);
+            if (SnakeBlock* sb = kind_cast<SnakeBlock>(block)) {
+                moving_snakes_.push_back(sb);
+                if (!sb->dragged_) {
+                    sb->collect_dragged_snake_links(map_, dir_, weak_links);
+                }
+            }
+            block->collect_sticky_links(map_, Sticky::Weak, weak_links);
+        }
+        for (auto it = comp->pushing_.rbegin(); it != comp->pushing_.rend(); ++it) {
+            to_visit.push_back(*it);
+        }
     }
 }
 
 void HorizontalStepProcessor::perform_horizontal_step() {
-    // Any block which moved forward could have moved off a ledge
-    fall_check_ = moving_blocks_;
-    std::unordered_set<SnakeBlock*> link_add_check {};
-    link_add_check.insert(moving_snakes_.begin(), moving_snakes_.end());
+    // The map notes which blocks moved (and what they left behind) for the
+    // fall check; only snake links broken here need adding by hand
+    ScratchVector<SnakeBlock*> link_add_check {};
+    for (auto sb : moving_snakes_) {
+        push_unique(link_add_check, sb);
+    }
     for (auto sb : moving_snakes_) {
-        sb->break_unmoving_links(fall_check_, delta_frame_);
+        sb->break_unmoving_links(map_, fall_check_, delta_frame_);
     }
     SnakePuller snake_puller {map_, delta_frame_, moving_blocks_, link_add_check, fall_check_};
     for (auto sb : moving_snakes_) {
@@ -122,9 +265,10 @@ void HorizontalStepProcessor::perform_horizontal_step() {
     }
     // MAP BECOMES INCONSISTENT HERE (potential ID overlap)
     // In this section of code, the map can't be viewed
-    auto forward_moving_blocks = moving_blocks_;
+    ScratchVector<GameObject*> forward_moving_blocks {};
+    forward_moving_blocks = moving_blocks_;
     snake_puller.perform_pulls();
-    map_->batch_shift(std::move(forward_moving_blocks), dir_, delta_frame_);
+    map_->batch_shift(forward_moving_blocks, dir_, delta_frame_);
     // MAP BECOMES CONSISTENT AGAIN HERE
     for (auto sb : moving_snakes_) {
         sb->reset_internal_state();
@@ -2,36 +2,52 @@
 
 #include "colorcycle.h"
 
-MapFileI::MapFileI(const std::string& path): file_ {} {
+MapFileI::MapFileI(const std::string& path): file_ {}, stream_ (file_), wide_coords_ {false} {
     file_.open(path, std::ios::in | std::ios::binary);
 }
 
+MapFileI::MapFileI(std::istream& stream): file_ {}, stream_ (stream), wide_coords_ {false} {}
+
 MapFileI::~MapFileI() {
     file_.close();
 }
 
 
 void MapFileI::read(unsigned char* b, int n) {
-    file_.read((char *)b, n);
+    stream_.read((char *)b, n);
 }
 
 unsigned char MapFileI::read_byte() {
     unsigned char b;
-    file_.read((char *)&b, 1);
+    stream_.read((char *)&b, 1);
     return b;
 }
 
+int MapFileI::read_coord() {
+    if (wide_coords_) {
+        unsigned char b[2];
+        read(b, 2);
+        return b[0] + (b[1] << 8);
+    }
+    return read_byte();
+}
+
 Point3 MapFileI::read_point3() {
-    unsigned char b[3];
-    read(b, 3);
-    return {b[0], b[1], b[2]};
+    int x = read_coord();
+    int y = read_coord();
+    int z = read_coord();
+    return {x, y, z};
+}
+
+void MapFileI::use_wide_coords() {
+    wide_coords_ = true;
 }
 
 std::string MapFileI::read_str() {
     unsigned char n;
     char b[256] = "";
     read(&n, 1);
-    file_.read(b, n);
+    stream_.read(b, n);
     return std::string(b, n);
 }
 
@@ -50,9 +66,8 @@ MapFileI& operator>>(MapFileI& f, float& v) {
 }
 
 MapFileI& operator>>(MapFileI& f, Point2& v) {
-    unsigned char b[2];
-    f.read(b, 2);
-    v = {b[0], b[1]};
+    v.x = f.read_coord();
+    v.y = f.read_coord();
     return f;
 }
 
@@ -66,14 +81,20 @@ MapFileI& operator>>(MapFileI& f, Point3_S16& v) {
 }
 
 MapFileI& operator>>(MapFileI& f, Point3& v) {
-    unsigned char b[3];
-    f.read(b, 3);
-    v = {b[0], b[1], b[2]};
+    v = f.read_point3();
     return f;
 }
 
+// The whole part of each component is a coordinate
+static float read_coord_float(MapFileI& f) {
+    int whole = f.read_coord();
+    return (float)whole + (float)f.read_byte()/256.0;
+}
+
 MapFileI& operator>>(MapFileI& f, FPoint3& v) {
-    f >> v.x >> v.y >> v.z;
+    v.x = read_coord_float(f);
+    v.y = read_coord_float(f);
+    v.z = read_coord_float(f);
     return f;
 }
 
@@ -86,114 +107,127 @@ MapFileI& operator>>(MapFileI& f, ColorCycle& v) {
 }
 
 
-MapFileO::MapFileO(const std::string& path): file_ {} {
+MapFileO::MapFileO(const std::string& path): file_ {}, stream_ (file_) {
     file_.open(path, std::ios::out | std::ios::binary);
 }
 
+MapFileO::MapFileO(std::ostream& stream): file_ {}, stream_ (stream) {}
+
 MapFileO::~MapFileO() {
     file_.close();
 }
 
 MapFileO& MapFileO::operator<<(unsigned char n) {
-    file_ << n;
+    stream_ << n;
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(int n) {
-    file_ << (unsigned char) n;
+    stream_ << (unsigned char) n;
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(unsigned int n) {
-    file_ << (unsigned char) n;
+    stream_ << (unsigned char) n;
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(float f) {
-    file_ << (unsigned char)f;
-    file_ << (unsigned char)(256.0*f);
+    stream_ << (unsigned char)f;
+    stream_ << (unsigned char)(256.0*f);
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(bool b) {
-    file_ << (unsigned char) b;
+    stream_ << (unsigned char) b;
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(Point2 pos) {
-    file_ << (unsigned char) pos.x;
-    file_ << (unsigned char) pos.y;
+    write_coord(pos.x);
+    write_coord(pos.y);
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(Point3_S16 pos) {
-    file_ << (unsigned char) pos.x;
-    file_ << (unsigned char) ((pos.x + (1 << 15)) >> 8);
-    file_ << (unsigned char) pos.y;
-    file_ << (unsigned char) ((pos.y + (1 << 15)) >> 8);
-    file_ << (unsigned char) pos.z;
-    file_ << (unsigned char) ((pos.z + (1 << 15)) >> 8);
+    stream_ << (unsigned char) pos.x;
+    stream_ << (unsigned char) ((pos.x + (1 << 15)) >> 8);
+    stream_ << (unsigned char) pos.y;
+    stream_ << (unsigned char) ((pos.y + (1 << 15)) >> 8);
+    stream_ << (unsigned char) pos.z;
+    stream_ << (unsigned char) ((pos.z + (1 << 15)) >> 8);
     return *this;
 }
 
-// NOTE: all Point3's that get serialized are actually in the range [0,255]
+// NOTE: all Point3's that get serialized are in the range [0,65535]
 MapFileO& MapFileO::operator<<(Point3 pos) {
-    file_ << (unsigned char) pos.x;
-    file_ << (unsigned char) pos.y;
-    file_ << (unsigned char) pos.z;
+    write_coord(pos.x);
+    write_coord(pos.y);
+    write_coord(pos.z);
     return *this;
 }
 
+static void write_coord_float(MapFileO& f, float v) {
+    int whole = (int)v;
+    f.write_coord(whole);
+    f << (unsigned char)(256.0*(v - whole));
+}
+
 MapFileO& MapFileO::operator<<(FPoint3 pos) {
-    *this << pos.x;
-    *this << pos.y;
-    *this << pos.z;
+    write_coord_float(*this, pos.x);
+    write_coord_float(*this, pos.y);
+    write_coord_float(*this, pos.z);
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(const std::string& str) {
-    file_ << (unsigned char) str.size();
-    file_.write(str.c_str(), str.size());
+    stream_ << (unsigned char) str.size();
+    stream_.write(str.c_str(), str.size());
     return *this;
 }
 
 // TODO: consider replacing these with a template!
 
 MapFileO& MapFileO::operator<<(MapCode code) {
-    file_ << (unsigned char) code;
+    stream_ << (unsigned char) code;
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(ObjCode code) {
-    file_ << (unsigned char) code;
+    stream_ << (unsigned char) code;
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(ModCode code) {
-    file_ << (unsigned char) code;
+    stream_ << (unsigned char) code;
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(CameraCode code) {
-    file_ << (unsigned char) code;
+    stream_ << (unsigned char) code;
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(Sticky sticky) {
-    file_ << (unsigned char) sticky;
+    stream_ << (unsigned char) sticky;
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(RidingState state) {
-    file_ << (unsigned char) state;
+    stream_ << (unsigned char) state;
     return *this;
 }
 
 MapFileO& MapFileO::operator<<(const ColorCycle& color) {
-    file_ << (unsigned char) color.size_;
-    file_ << (unsigned char) color.index_;
+    stream_ << (unsigned char) color.size_;
+    stream_ << (unsigned char) color.index_;
     for (int i = 0; i < color.size_; ++i) {
-        file_ << (unsigned char) color.color_[i];
+        stream_ << (unsigned char) color.color_[i];
     }
     return *this;
 }
+
+void MapFileO::write_coord(int n) {
+    stream_ << (unsigned char) n;
+    stream_ << (unsigned char) (n >> 8);
+}
@@ -1,10 +1,13 @@
 #include "maplayer.h"
 
+#include <algorithm>
+
 #include "delta.h"
 #include "gameobject.h"
 #include "mapfile.h"
 #include "graphicsmanager.h"
 #include "gameobjectarray.h"
+#include "roommap.h"
 
 
 bool MapRect::contains(Point2 p) {
@@ -12,105 +15,626 @@ bool MapRect::contains(Point2 p) {
 }
 
 
-MapLayer::MapLayer(RoomMap* room_map): parent_map_ {room_map} {}
+MapLayer::MapLayer(RoomMap* room_map): parent_map_ {room_map}, count_ {0} {}
 
 MapLayer::~MapLayer() {}
 
+int MapLayer::count() {
+    return count_;
+}
+
 
 FullMapLayer::FullMapLayer(RoomMap* room_map, int width, int height):
-        MapLayer(room_map), map_ {}, width_ {width}, height_ {height} {
-    for (int i = 0; i != width; ++i) {
-        map_.push_back(std::vector<int>(height, 0));
-    }
+        MapLayer(room_map), map_ (width*height, 0), occupied_ {},
+        width_ {width}, height_ {height},
+        row_words_ {(width + OCCUPANCY_WORD_BITS - 1) / OCCUPANCY_WORD_BITS} {
+    occupied_.resize(row_words_*height, 0);
 }
 
 FullMapLayer::~FullMapLayer() {}
 
-int& FullMapLayer::at(Point2 pos) {
-    return map_[pos.x][pos.y];
+OccupancyWord& FullMapLayer::occupancy_word(int x, int y) {
+    return occupied_[row_words_*y + x / OCCUPANCY_WORD_BITS];
+}
+
+int FullMapLayer::at(Point2 pos) {
+    return map_[pos.x + width_*pos.y];
+}
+
+void FullMapLayer::set(Point2 pos, int id) {
+    int& cell = map_[pos.x + width_*pos.y];
+    count_ += (id != 0) - (cell != 0);
+    cell = id;
+    OccupancyWord bit = OccupancyWord{1} << (pos.x % OCCUPANCY_WORD_BITS);
+    if (id) {
+        occupancy_word(pos.x, pos.y) |= bit;
+    } else {
+        occupancy_word(pos.x, pos.y) &= ~bit;
+    }
 }
 
 MapCode FullMapLayer::type() {
     return MapCode::FullLayer;
 }
 
-void FullMapLayer::apply_to_rect(MapRect rect, GameObjIDFunc& f) {
-    for (int i = rect.x; i < rect.x + rect.w; ++i) {
-        for (int j = rect.y; j < rect.y + rect.h; ++j) {
-            if (int id = map_[i][j]) {
-                f(id);
-            }
+std::size_t FullMapLayer::memory_usage() {
+    return sizeof(*this) + map_.capacity()*sizeof(int) + occupied_.capacity()*sizeof(OccupancyWord);
+}
+
+void FullMapLayer::copy_into(MapLayer& layer) {
+    for (int j = 0; j < height_; ++j) {
+        for (int w = 0; w < row_words_; ++w) {
+            int base = w*OCCUPANCY_WORD_BITS;
+            for_each_occupied_bit(occupied_[row_words_*j + w], ~OccupancyWord{0}, [&](int b) {
+                layer.set({base + b, j}, map_[base + b + width_*j]);
+            });
         }
     }
 }
 
-void FullMapLayer::shift_by(int dx, int dy) {
-    width_ += dx;
-    height_ += dy;
-    if (dy < 0) {
-        for (auto& row : map_) {
-            row.erase(row.begin(), row.begin() - dy);
+// Move the occupied cells into buffers of the new size, with the old
+// origin landing at (dx,dy); cells that fall outside are discarded.
+void FullMapLayer::relayout(int width, int height, int dx, int dy) {
+    auto old_map = std::move(map_);
+    auto old_occupied = std::move(occupied_);
+    int old_width = width_;
+    int old_height = height_;
+    int old_row_words = row_words_;
+    width_ = width;
+    height_ = height;
+    row_words_ = (width + OCCUPANCY_WORD_BITS - 1) / OCCUPANCY_WORD_BITS;
+    map_.assign(width*height, 0);
+    occupied_.assign(row_words_*height, 0);
+    count_ = 0;
+    for (int j = 0; j < old_height; ++j) {
+        for (int w = 0; w < old_row_words; ++w) {
+            int base = w*OCCUPANCY_WORD_BITS;
+            for_each_occupied_bit(old_occupied[old_row_words*j + w], ~OccupancyWord{0}, [&](int b) {
+                Point2 pos {base + b + dx, j + dy};
+                if (0 <= pos.x && pos.x < width && 0 <= pos.y && pos.y < height) {
+                    set(pos, old_map[base + b + old_width*j]);
+                }
+            });
         }
-    } else if (dy > 0) {
-        for (auto& row : map_) {
-            row.insert(row.begin(), dy, 0);
+    }
+}
+
+void FullMapLayer::shift_by(int dx, int dy) {
+    relayout(width_ + dx, height_ + dy, dx, dy);
+}
+
+void FullMapLayer::extend_by(int dx, int dy) {
+    relayout(width_ + dx, height_ + dy, 0, 0);
+}
+
+
+const unsigned int SparseMapLayer::EMPTY_KEY;
+const int SparseMapLayer::MIN_CAPACITY;
+
+SparseMapLayer::SparseMapLayer(RoomMap* room_map): MapLayer(room_map),
+slots_ {}, rows_ {} {}
+
+SparseMapLayer::~SparseMapLayer() {}
+
+// Positions within a room are nonnegative and fit in 16 bits
+unsigned int SparseMapLayer::pack(Point2 pos) {
+    return (static_cast<unsigned int>(pos.x) << 16) | static_cast<unsigned int>(pos.y);
+}
+
+Point2 SparseMapLayer::unpack(unsigned int key) {
+    return {static_cast<int>(key >> 16), static_cast<int>(key & 0xffff)};
+}
+
+// Fibonacci hashing; the capacity is always a power of 2, and the slot
+// comes from the top bits of the product (the bottom bits of a key's
+// product only depend on its bottom bits, i.e. on y alone)
+unsigned int SparseMapLayer::home_slot(unsigned int key) {
+    return (key * 2654435769u) >> (__builtin_clz(static_cast<unsigned int>(slots_.size())) + 1);
+}
+
+int SparseMapLayer::find(unsigned int key) {
+    if (slots_.empty()) {
+        return -1;
+    }
+    unsigned int mask = slots_.size() - 1;
+    for (unsigned int i = home_slot(key);; i = (i + 1) & mask) {
+        if (slots_[i].key == key) {
+            return i;
+        } else if (slots_[i].key == EMPTY_KEY) {
+            return -1;
         }
     }
-    if (dx < 0) {
-        map_.erase(map_.begin(), map_.begin() - dx);
-    } else {
-        map_.insert(map_.begin(), dx, std::vector<int>(height_,0));
+}
+
+void SparseMapLayer::insert(unsigned int key, int id) {
+    // Keep the load factor at most 1/2
+    if (2*(count_ + 1) > (int)slots_.size()) {
+        rehash(std::max(MIN_CAPACITY, 2*(int)slots_.size()));
+    }
+    unsigned int mask = slots_.size() - 1;
+    unsigned int i = home_slot(key);
+    while (slots_[i].key != EMPTY_KEY) {
+        i = (i + 1) & mask;
     }
+    slots_[i] = {key, id};
+    ++count_;
 }
 
-void FullMapLayer::extend_by(int dx, int dy) {
-    width_ += dx;
-    height_ += dy;
-    if (dy < 0) {
-        for (auto& row : map_) {
-            row.erase(row.end() + dy, row.end());
+// Backward shift deletion: no tombstones are left behind, so
+// cells that empty out don't cost anything afterwards
+void SparseMapLayer::erase(int i) {
+    unsigned int mask = slots_.size() - 1;
+    unsigned int hole = i;
+    for (unsigned int j = (hole + 1) & mask; slots_[j].key != EMPTY_KEY; j = (j + 1) & mask) {
+        unsigned int home = home_slot(slots_[j].key);
+        // Move j into the hole unless its home lies cyclically in (hole, j]
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            slots_[hole] = slots_[j];
+            hole = j;
         }
-    } else if (dy > 0) {
-        for (auto& row : map_) {
-            row.insert(row.end(), dy, 0);
+    }
+    slots_[hole].key = EMPTY_KEY;
+    --count_;
+    // An emptied layer keeps a minimal table, so that a lone object
+    // moving around in it doesn't free and reallocate it every step
+    if (count_ == 0) {
+        if ((int)slots_.size() > MIN_CAPACITY) {
+            rehash(MIN_CAPACITY);
         }
+    } else if (8*count_ < (int)slots_.size() && (int)slots_.size() > MIN_CAPACITY) {
+        rehash(slots_.size() / 2);
     }
-    if (dx < 0) {
-        map_.erase(map_.end() + dx, map_.end());
-    } else {
-        map_.insert(map_.end(), dx, std::vector<int>(height_,0));
+}
+
+void SparseMapLayer::rehash(int capacity) {
+    std::vector<Slot> old_slots (capacity, Slot{EMPTY_KEY, 0});
+    old_slots.swap(slots_);
+    count_ = 0;
+    for (Slot& slot : old_slots) {
+        if (slot.key != EMPTY_KEY) {
+            insert(slot.key, slot.id);
+        }
     }
 }
 
+void SparseMapLayer::add_to_row(Point2 pos) {
+    if (pos.y >= (int)rows_.size()) {
+        rows_.resize(pos.y + 1);
+    }
+    rows_[pos.y].push_back(pos.x);
+}
 
-SparseMapLayer::SparseMapLayer(RoomMap* room_map): MapLayer(room_map), map_ {} {}
+void SparseMapLayer::remove_from_row(Point2 pos) {
+    auto& row = rows_[pos.y];
+    *std::find(row.begin(), row.end(), pos.x) = row.back();
+    row.pop_back();
+}
 
-SparseMapLayer::~SparseMapLayer() {}
+int SparseMapLayer::at(Point2 pos) {
+    int i = find(pack(pos));
+    return (i == -1) ? 0 : slots_[i].id;
+}
 
-// TODO: fix the way that SparseMapLayers can fill up with empty data
-int& SparseMapLayer::at(Point2 pos) {
-    return map_[pos];
+void SparseMapLayer::set(Point2 pos, int id) {
+    unsigned int key = pack(pos);
+    int i = find(key);
+    if (i != -1) {
+        if (id) {
+            slots_[i].id = id;
+        } else {
+            erase(i);
+            remove_from_row(pos);
+        }
+    } else if (id) {
+        insert(key, id);
+        add_to_row(pos);
+    }
 }
 
 MapCode SparseMapLayer::type() {
     return MapCode::SparseLayer;
 }
 
-void SparseMapLayer::apply_to_rect(MapRect rect, GameObjIDFunc& f) {
-    for (auto& p : map_) {
-        if (rect.contains(p.first) && p.second) {
-            f(p.second);
+std::size_t SparseMapLayer::memory_usage() {
+    std::size_t bytes = sizeof(*this) + slots_.capacity()*sizeof(Slot) + rows_.capacity()*sizeof(std::vector<int>);
+    for (auto& row : rows_) {
+        bytes += row.capacity()*sizeof(int);
+    }
+    return bytes;
+}
+
+void SparseMapLayer::collect_ids(MapRect rect, std::vector<int>& ids) {
+    int y_end = std::min(rect.y + rect.h, (int)rows_.size());
+    for (int y = std::max(rect.y, 0); y < y_end; ++y) {
+        for (int x : rows_[y]) {
+            if (rect.x <= x && x < rect.x + rect.w) {
+                ids.push_back(at({x, y}));
+            }
+        }
+    }
+}
+
+void SparseMapLayer::copy_into(MapLayer& layer) {
+    for (Slot& slot : slots_) {
+        if (slot.key != EMPTY_KEY) {
+            layer.set(unpack(slot.key), slot.id);
+        }
+    }
+}
+
+// Move every cell by (dx,dy), discarding those which leave the room
+void SparseMapLayer::rebuild(int dx, int dy) {
+    int width = parent_map_->width_;
+    int height = parent_map_->height_;
+    std::vector<Slot> old_slots {};
+    old_slots.swap(slots_);
+    rows_.clear();
+    count_ = 0;
+    for (Slot& slot : old_slots) {
+        if (slot.key != EMPTY_KEY) {
+            Point2 pos = unpack(slot.key) + Point2{dx, dy};
+            if (0 <= pos.x && pos.x < width && 0 <= pos.y && pos.y < height) {
+                set(pos, slot.id);
+            }
         }
     }
 }
 
 void SparseMapLayer::shift_by(int dx, int dy) {
-    Point2 dpos = {dx,dy};
-    std::unordered_map<Point2, int, Point2Hash> new_map {};
-    for (auto& p : map_) {
-        new_map[p.first + dpos] = p.second;
+    rebuild(dx, dy);
+}
+
+void SparseMapLayer::extend_by(int dx, int dy) {
+    if (dx < 0 || dy < 0) {
+        rebuild(0, 0);
+    }
+}
+
+
+const int ChunkedMapLayer::CHUNK_BITS;
+const int ChunkedMapLayer::CHUNK_SIZE;
+const int ChunkedMapLayer::CHUNK_MASK;
+const int ChunkedMapLayer::CHUNK_WORDS;
+
+ChunkedMapLayer::ChunkedMapLayer(RoomMap* room_map, int width, int height):
+MapLayer(room_map), chunks_ {},
+width_ {width}, height_ {height},
+chunks_w_ {(width + CHUNK_MASK) >> CHUNK_BITS},
+chunks_h_ {(height + CHUNK_MASK) >> CHUNK_BITS},
+live_chunks_ {0}, iterating_ {false} {}
+
+ChunkedMapLayer::~ChunkedMapLayer() {}
+
+int ChunkedMapLayer::chunk_index(Point2 pos) {
+    return (pos.x >> CHUNK_BITS) + chunks_w_*(pos.y >> CHUNK_BITS);
+}
+
+int ChunkedMapLayer::at(Point2 pos) {
+    if (chunks_.empty()) {
+        return 0;
+    }
+    if (Chunk* chunk = chunks_[chunk_index(pos)].get()) {
+        return chunk->cells[(pos.x & CHUNK_MASK) + ((pos.y & CHUNK_MASK) << CHUNK_BITS)];
+    }
+    return 0;
+}
+
+void ChunkedMapLayer::set(Point2 pos, int id) {
+    if (chunks_.empty()) {
+        if (!id) {
+            return;
+        }
+        chunks_.resize(chunks_w_*chunks_h_);
+    }
+    int k = chunk_index(pos);
+    Chunk* chunk = chunks_[k].get();
+    if (!chunk) {
+        if (!id) {
+            return;
+        }
+        chunks_[k] = std::make_unique<Chunk>();
+        chunk = chunks_[k].get();
+        ++live_chunks_;
+    }
+    int k_cell = (pos.x & CHUNK_MASK) + ((pos.y & CHUNK_MASK) << CHUNK_BITS);
+    int& cell = chunk->cells[k_cell];
+    chunk->count += (id != 0) - (cell != 0);
+    count_ += (id != 0) - (cell != 0);
+    cell = id;
+    OccupancyWord bit = OccupancyWord{1} << (k_cell % OCCUPANCY_WORD_BITS);
+    if (id) {
+        chunk->occupied[k_cell / OCCUPANCY_WORD_BITS] |= bit;
+    } else {
+        chunk->occupied[k_cell / OCCUPANCY_WORD_BITS] &= ~bit;
+    }
+    if (!chunk->count && !iterating_) {
+        release_chunk(k);
+    }
+}
+
+void ChunkedMapLayer::release_chunk(int k) {
+    chunks_[k].reset(nullptr);
+    if (--live_chunks_ == 0) {
+        chunks_.clear();
+        chunks_.shrink_to_fit();
     }
-    map_ = std::move(new_map);
 }
 
-void SparseMapLayer::extend_by(int dx, int dy) {}
+MapCode ChunkedMapLayer::type() {
+    return MapCode::ChunkedLayer;
+}
+
+std::size_t ChunkedMapLayer::memory_usage() {
+    return sizeof(*this) + chunks_.capacity()*sizeof(std::unique_ptr<Chunk>) + live_chunks_*sizeof(Chunk);
+}
+
+// Now it's safe to free whatever was emptied out during iteration
+void ChunkedMapLayer::release_empty_chunks(int cx0, int cx1, int cy0, int cy1) {
+    for (int cy = cy0; cy <= cy1 && !chunks_.empty(); ++cy) {
+        for (int cx = cx0; cx <= cx1 && !chunks_.empty(); ++cx) {
+            auto& chunk = chunks_[cx + chunks_w_*cy];
+            if (chunk && !chunk->count) {
+                release_chunk(cx + chunks_w_*cy);
+            }
+        }
+    }
+}
+
+void ChunkedMapLayer::copy_into(MapLayer& layer) {
+    for (int k = 0; k < (int)chunks_.size(); ++k) {
+        Chunk* chunk = chunks_[k].get();
+        if (!chunk) {
+            continue;
+        }
+        int x0 = (k % chunks_w_) << CHUNK_BITS;
+        int y0 = (k / chunks_w_) << CHUNK_BITS;
+        for (int w = 0; w < CHUNK_WORDS; ++w) {
+            int base = w*OCCUPANCY_WORD_BITS;
+            for_each_occupied_bit(chunk->occupied[w], ~OccupancyWord{0}, [&](int b) {
+                layer.set({x0 + ((base + b) & CHUNK_MASK), y0 + ((base + b) >> CHUNK_BITS)}, chunk->cells[base + b]);
+            });
+        }
+    }
+}
+
+// Rebuilding only visits allocated chunks, so it's proportional to occupancy
+void ChunkedMapLayer::relayout(int width, int height, int dx, int dy) {
+    auto old_chunks = std::move(chunks_);
+    int old_chunks_w = chunks_w_;
+    chunks_.clear();
+    live_chunks_ = 0;
+    count_ = 0;
+    width_ = width;
+    height_ = height;
+    chunks_w_ = (width + CHUNK_MASK) >> CHUNK_BITS;
+    chunks_h_ = (height + CHUNK_MASK) >> CHUNK_BITS;
+    for (int k = 0; k < (int)old_chunks.size(); ++k) {
+        Chunk* chunk = old_chunks[k].get();
+        if (!chunk) {
+            continue;
+        }
+        int x0 = ((k % old_chunks_w) << CHUNK_BITS) + dx;
+        int y0 = ((k / old_chunks_w) << CHUNK_BITS) + dy;
+        for (int w = 0; w < CHUNK_WORDS; ++w) {
+            int base = w*OCCUPANCY_WORD_BITS;
+            for_each_occupied_bit(chunk->occupied[w], ~OccupancyWord{0}, [&](int b) {
+                Point2 pos {x0 + ((base + b) & CHUNK_MASK), y0 + ((base + b) >> CHUNK_BITS)};
+                if (0 <= pos.x && pos.x < width && 0 <= pos.y && pos.y < height) {
+                    set(pos, chunk->cells[base + b]);
+                }
+            });
+        }
+    }
+}
+
+void ChunkedMapLayer::shift_by(int dx, int dy) {
+    relayout(width_ + dx, height_ + dy, dx, dy);
+}
+
+void ChunkedMapLayer::extend_by(int dx, int dy) {
+    relayout(width_ + dx, height_ + dy, 0, 0);
+}
+
+
+BitLayer::BitLayer(int width, int height, int depth): bits_ {},
+width_ {width}, height_ {height}, depth_ {depth},
+row_words_ {(width + OCCUPANCY_WORD_BITS - 1) / OCCUPANCY_WORD_BITS} {
+    bits_.resize(row_words_*height*depth, 0);
+}
+
+BitLayer::~BitLayer() {}
+
+OccupancyWord* BitLayer::row(int y, int z) {
+    return &bits_[row_words_*(y + height_*z)];
+}
+
+bool BitLayer::at(Point3 pos) {
+    return (row(pos.y, pos.z)[pos.x / OCCUPANCY_WORD_BITS] >> (pos.x % OCCUPANCY_WORD_BITS)) & 1;
+}
+
+void BitLayer::set(Point3 pos, bool bit) {
+    OccupancyWord mask = OccupancyWord{1} << (pos.x % OCCUPANCY_WORD_BITS);
+    if (bit) {
+        row(pos.y, pos.z)[pos.x / OCCUPANCY_WORD_BITS] |= mask;
+    } else {
+        row(pos.y, pos.z)[pos.x / OCCUPANCY_WORD_BITS] &= ~mask;
+    }
+}
+
+// A whole word at a time
+void BitLayer::fill_run(Point3 start, int length) {
+    OccupancyWord* words = row(start.y, start.z);
+    int x_end = start.x + length;
+    for (int x = start.x; x < x_end;) {
+        int base = x - x % OCCUPANCY_WORD_BITS;
+        int hi = std::min(x_end - base, OCCUPANCY_WORD_BITS);
+        words[x / OCCUPANCY_WORD_BITS] |= occupancy_mask(x - base, hi);
+        x = base + hi;
+    }
+}
+
+// The first x' >= x whose bit is (or isn't) set, or width_ if there isn't one
+int BitLayer::next_run_boundary(OccupancyWord* words, int x, bool bit) {
+    for (int w = x / OCCUPANCY_WORD_BITS; w < row_words_; ++w) {
+        OccupancyWord bits = bit ? words[w] : ~words[w];
+        if (w == x / OCCUPANCY_WORD_BITS) {
+            bits &= ~OccupancyWord{0} << (x % OCCUPANCY_WORD_BITS);
+        }
+        if (bits) {
+            return std::min(w*OCCUPANCY_WORD_BITS + __builtin_ctzll(bits), width_);
+        }
+    }
+    return width_;
+}
+
+// Each nonempty row is written as y, z, (number of runs), then x and
+// length for each run; an empty row (0,0,0) marks the end.
+void BitLayer::serialize(MapFileO& file) {
+    std::vector<int> runs {};
+    for (int z = 0; z < depth_; ++z) {
+        for (int y = 0; y < height_; ++y) {
+            OccupancyWord* words = row(y, z);
+            runs.clear();
+            int x = next_run_boundary(words, 0, true);
+            while (x < width_) {
+                int end = next_run_boundary(words, x, false);
+                runs.push_back(x);
+                runs.push_back(end - x);
+                x = next_run_boundary(words, end, true);
+            }
+            if (runs.empty()) {
+                continue;
+            }
+            file.write_coord(y);
+            file.write_coord(z);
+            file.write_coord(runs.size() / 2);
+            for (int v : runs) {
+                file.write_coord(v);
+            }
+        }
+    }
+    file.write_coord(0);
+    file.write_coord(0);
+    file.write_coord(0);
+}
+
+// The old contents land with their origin at d; bits that fall outside are lost
+void BitLayer::relayout(int width, int height, int depth, Point3 d) {
+    auto old_bits = std::move(bits_);
+    int old_height = height_;
+    int old_depth = depth_;
+    int old_row_words = row_words_;
+    width_ = width;
+    height_ = height;
+    depth_ = depth;
+    row_words_ = (width + OCCUPANCY_WORD_BITS - 1) / OCCUPANCY_WORD_BITS;
+    bits_.assign(row_words_*height*depth, 0);
+    for (int z = 0; z < old_depth; ++z) {
+        for (int y = 0; y < old_height; ++y) {
+            for (int w = 0; w < old_row_words; ++w) {
+                int base = w*OCCUPANCY_WORD_BITS;
+                for_each_occupied_bit(old_bits[old_row_words*(y + old_height*z) + w], ~OccupancyWord{0}, [&](int b) {
+                    Point3 pos {base + b + d.x, y + d.y, z + d.z};
+                    if (0 <= pos.x && pos.x < width && 0 <= pos.y && pos.y < height && 0 <= pos.z && pos.z < depth) {
+                        set(pos, true);
+                    }
+                });
+            }
+        }
+    }
+}
+
+void BitLayer::shift_by(Point3 d) {
+    relayout(width_ + d.x, height_ + d.y, depth_ + d.z, d);
+}
+
+void BitLayer::extend_by(Point3 d) {
+    relayout(width_ + d.x, height_ + d.y, depth_ + d.z, {0,0,0});
+}
+
+std::size_t BitLayer::memory_usage() {
+    return sizeof(*this) + bits_.capacity()*sizeof(OccupancyWord);
+}
+
+
+ColumnIndex::ColumnIndex(int width, int height, int depth): bits_ {},
+width_ {width}, height_ {height}, depth_ {depth},
+column_words_ {(depth + OCCUPANCY_WORD_BITS - 1) / OCCUPANCY_WORD_BITS} {
+    bits_.resize(column_words_*width*height, 0);
+}
+
+ColumnIndex::~ColumnIndex() {}
+
+OccupancyWord* ColumnIndex::column(int x, int y) {
+    return &bits_[column_words_*(x + width_*y)];
+}
+
+bool ColumnIndex::at(Point3 pos) {
+    return (column(pos.x, pos.y)[pos.z / OCCUPANCY_WORD_BITS] >> (pos.z % OCCUPANCY_WORD_BITS)) & 1;
+}
+
+void ColumnIndex::set(Point3 pos, bool bit) {
+    OccupancyWord mask = OccupancyWord{1} << (pos.z % OCCUPANCY_WORD_BITS);
+    if (bit) {
+        column(pos.x, pos.y)[pos.z / OCCUPANCY_WORD_BITS] |= mask;
+    } else {
+        column(pos.x, pos.y)[pos.z / OCCUPANCY_WORD_BITS] &= ~mask;
+    }
+}
+
+int ColumnIndex::highest_below(Point3 pos) {
+    int z = std::min(pos.z, depth_) - 1;
+    if (z < 0) {
+        return -1;
+    }
+    OccupancyWord* words = column(pos.x, pos.y);
+    int w = z / OCCUPANCY_WORD_BITS;
+    OccupancyWord bits = words[w] & occupancy_mask(0, z % OCCUPANCY_WORD_BITS + 1);
+    while (true) {
+        if (bits) {
+            return w*OCCUPANCY_WORD_BITS + OCCUPANCY_WORD_BITS - 1 - __builtin_clzll(bits);
+        }
+        if (--w < 0) {
+            return -1;
+        }
+        bits = words[w];
+    }
+}
+
+// The old contents land with their origin at d; bits that fall outside are lost
+void ColumnIndex::relayout(int width, int height, int depth, Point3 d) {
+    auto old_bits = std::move(bits_);
+    int old_width = width_;
+    int old_height = height_;
+    int old_column_words = column_words_;
+    width_ = width;
+    height_ = height;
+    depth_ = depth;
+    column_words_ = (depth + OCCUPANCY_WORD_BITS - 1) / OCCUPANCY_WORD_BITS;
+    bits_.assign(column_words_*width*height, 0);
+    for (int y = 0; y < old_height; ++y) {
+        for (int x = 0; x < old_width; ++x) {
+            for (int w = 0; w < old_column_words; ++w) {
+                int base = w*OCCUPANCY_WORD_BITS;
+                for_each_occupied_bit(old_bits[old_column_words*(x + old_width*y) + w], ~OccupancyWord{0}, [&](int b) {
+                    Point3 pos {x + d.x, y + d.y, base + b + d.z};
+                    if (0 <= pos.x && pos.x < width && 0 <= pos.y && pos.y < height && 0 <= pos.z && pos.z < depth) {
+                        set(pos, true);
+                    }
+                });
+            }
+        }
+    }
+}
+
+void ColumnIndex::shift_by(Point3 d) {
+    relayout(width_ + d.x, height_ + d.y, depth_ + d.z, d);
+}
+
+void ColumnIndex::extend_by(Point3 d) {
+    relayout(width_ + d.x, height_ + d.y, depth_ + d.z, {0,0,0});
+}
+
+std::size_t ColumnIndex::memory_usage() {
+    return sizeof(*this) + bits_.capacity()*sizeof(OccupancyWord);
+}
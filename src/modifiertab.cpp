@@ -28,7 +28,7 @@ static bool inspect_mode = false;
 // Model objects that new objects are created from
 static Car model_car {nullptr, {}};
 static Door model_door {nullptr, true, false};
-static Gate model_gate {nullptr, nullptr, 0, false, false, false};
+static Gate model_gate {nullptr, 0, false, false, false};
 static PressSwitch model_press_switch {nullptr, 0, false, false};
 
 static ColorCycle model_color_cycle {};
@@ -165,8 +165,9 @@ void ModifierTab::handle_left_click(EditorRoom* eroom, Point3 pos) {
             gate->parent_ = obj;
             // Create the GateBody too, so that serialization occurs properly!
             auto gate_body = std::make_unique<GateBody>(gate.get(), gate->pos_above());
-            gate->body_ = gate_body.get();
+            GateBody* body = gate_body.get();
             room_map->create_abstract(std::move(gate_body), nullptr);
+            gate->body_ = body->handle();
             mod = std::move(gate);
         }
         break;
@@ -181,7 +182,7 @@ void ModifierTab::handle_left_click(EditorRoom* eroom, Point3 pos) {
     }
     mod->parent_ = obj;
     selected_obj = obj;
-    obj->set_modifier(std::move(mod));
+    room_map->set_modifier(obj, std::move(mod));
 }
 
 void ModifierTab::handle_right_click(EditorRoom* eroom, Point3 pos) {
@@ -194,7 +195,7 @@ void ModifierTab::handle_right_click(EditorRoom* eroom, Point3 pos) {
     if (GameObject* obj = room_map->view(pos)) {
         if (ObjectModifier* mod = obj->modifier()) {
             mod->cleanup_on_destruction(room_map);
-            obj->set_modifier({});
+            room_map->set_modifier(obj, {});
         }
     }
 }
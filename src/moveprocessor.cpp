@@ -3,8 +3,10 @@
 #include <algorithm>
 
 #include "common_constants.h"
+#include "slab.h"
 
 #include "gameobject.h"
+#include "gameobjectarray.h"
 #include "player.h"
 #include "gatebody.h"
 #include "delta.h"
@@ -18,13 +20,21 @@
 #include "fallstepprocessor.h"
 
 MoveProcessor::MoveProcessor(PlayingState* playing_state, RoomMap* room_map, DeltaFrame* delta_frame, bool animated):
-fall_check_ {}, moving_blocks_ {},
+moving_blocks_ {}, fall_check_ {}, gate_transitions_ {},
 playing_state_ {playing_state}, map_ {room_map}, delta_frame_ {delta_frame},
 frames_ {0}, state_ {},
 animated_ {animated} {}
 
 MoveProcessor::~MoveProcessor() {}
 
+void* MoveProcessor::operator new(std::size_t size) {
+    return slab_new<MoveProcessor>(size);
+}
+
+void MoveProcessor::operator delete(void* block, std::size_t size) {
+    slab_delete<MoveProcessor>(block, size);
+}
+
 bool MoveProcessor::try_move(Player* player, Point3 dir) {
     if (player->state_ == RidingState::Bound) {
         move_bound(player, dir);
@@ -103,27 +113,22 @@ void MoveProcessor::color_change(Player* player) {
     state_ = MoveStep::ColorChange;
     // TODO: consider renaming
     frames_ = COLOR_CHANGE_MOVEMENT_FRAMES;
-    delta_frame_->push(std::make_unique<ColorChangeDelta>(car, true));
-    fall_check_.push_back(car->parent_);
-    for (Point3 d : DIRECTIONS) {
-        if (GameObject* block = map_->view(car->shifted_pos(d))) {
-            fall_check_.push_back(block);
-        }
-    }
+    map_->update_color(car->parent_);
+    delta_frame_->push(std::make_unique<ColorChangeDelta>(car, map_, true));
 }
 
 void MoveProcessor::try_fall_step() {
     moving_blocks_.clear();
+    map_->collect_fall_check(fall_check_);
     if (!fall_check_.empty()) {
-        FallStepProcessor(map_, delta_frame_, std::move(fall_check_)).run();
-        fall_check_.clear();
+        FallStepProcessor(map_, delta_frame_, fall_check_).run();
     }
 }
 
 void MoveProcessor::perform_switch_checks(bool skippable) {
     delta_frame_->reset_changed();
     map_->alert_activated_listeners(delta_frame_, this);
-    map_->reset_local_state();
+    map_->reset_listener_state();
     map_->check_signalers(delta_frame_, this);
     if (!skippable || delta_frame_->changed()) {
         state_ = MoveStep::PreFallSwitch;
@@ -135,14 +140,14 @@ void MoveProcessor::try_door_move(Door* door) {
     if (!door->state()) {
         return;
     }
-    std::vector<GameObject*> objs_to_move {};
+    ScratchVector<GameObject*> objs_to_move {};
     // TODO: make this more general later
     // Also, it should probably be the responsibility of the objects/door, not the MoveProcessor
     if (GameObject* above = map_->view(door->pos_above())) {
-        if (Player* player = dynamic_cast<Player*>(above)) {
+        if (Player* player = kind_cast<Player>(above)) {
             objs_to_move.push_back(player);
-        } else if (Car* car = dynamic_cast<Car*>(above->modifier())) {
-            if (Player* player = dynamic_cast<Player*>(map_->view(car->pos_above()))) {
+        } else if (Car* car = kind_cast<Car>(above->modifier())) {
+            if (Player* player = kind_cast<Player>(map_->view(car->pos_above()))) {
                 if (player->state_ == RidingState::Riding) {
                     objs_to_move.push_back(player);
                     objs_to_move.push_back(above);
@@ -172,7 +177,7 @@ void MoveProcessor::add_to_fall_check(GameObject* obj) {
 // This is a bit of a hack; the animation system should be overhauled when we understand it better
 void MoveProcessor::add_gate_transition(GateBody* gate_body, bool state) {
     if (animated_) {
-        gate_body->set_gate_transition_animation(state, this);
+        gate_body->set_gate_transition_animation(state, map_, this);
         gate_transitions_.push_back(std::make_pair(gate_body, state));
     }
 }
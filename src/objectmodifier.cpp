@@ -2,10 +2,15 @@
 
 #include "gameobject.h"
 
-ObjectModifier::ObjectModifier(GameObject* parent): parent_ {parent} {}
+ObjectModifier::ObjectModifier(GameObject* parent, ModCode kind): parent_ {parent},
+activated_gen_ {0}, moved_gen_ {0}, kind_ {kind}, listening_ {false}, listen_pos_ {}, index_slot_ {-1} {}
 
 ObjectModifier::~ObjectModifier() {}
 
+// A copy hasn't been queued or registered anywhere yet
+ObjectModifier::ObjectModifier(const ObjectModifier& mod): parent_ {mod.parent_},
+activated_gen_ {0}, moved_gen_ {0}, kind_ {mod.kind_}, listening_ {false}, listen_pos_ {}, index_slot_ {-1} {}
+
 bool ObjectModifier::relation_check() {
     return false;
 }
@@ -24,8 +29,6 @@ Point3 ObjectModifier::shifted_pos(Point3 d) {
     return parent_->pos_ + d;
 }
 
-void ObjectModifier::shift_internal_pos(Point3 d) {}
-
 Point3 ObjectModifier::pos_above() {
     return parent_->pos_ + Point3{0,0,1};
 }
@@ -38,14 +41,8 @@ bool ObjectModifier::gravitable() {
     return parent_->gravitable_;
 }
 
-void ObjectModifier::setup_on_put(RoomMap* room_map) {}
-
-void ObjectModifier::cleanup_on_take(RoomMap* room_map) {}
-
 void ObjectModifier::cleanup_on_destruction(RoomMap* room_map) {}
 
 void ObjectModifier::setup_on_undestruction(RoomMap* room_map) {}
 
-void ObjectModifier::map_callback(RoomMap*, DeltaFrame*, MoveProcessor*) {}
-
 void ObjectModifier::collect_sticky_links(RoomMap*, Sticky, std::vector<GameObject*>&) {}
@@ -1,6 +1,7 @@
 #include "objecttab.h"
 
 #include "color_constants.h"
+#include "common_constants.h"
 
 #include "editorstate.h"
 #include "room.h"
@@ -149,7 +150,11 @@ void ObjectTab::handle_right_click(EditorRoom* eroom, Point3 pos) {
             return;
         }
         selected_obj = nullptr;
-        // When we "destroy" a wall, it doesn't actually destroy the unique Wall object
-        room_map->destroy(obj, nullptr);
+        // There's only one Wall object, so walls are removed from the wall layer instead
+        if (obj->id_ == GLOBAL_WALL_ID) {
+            room_map->remove_wall(pos);
+        } else {
+            room_map->destroy(obj, nullptr);
+        }
     }
 }
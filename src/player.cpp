@@ -1,5 +1,6 @@
 #include "player.h"
 
+#include "slab.h"
 #include "pushblock.h"
 
 #include "delta.h"
@@ -8,10 +9,18 @@
 #include "mapfile.h"
 #include "car.h"
 
-Player::Player(Point3 pos, RidingState state): PushBlock(pos, PINK, true, true, Sticky::None), state_ {state} {}
+Player::Player(Point3 pos, RidingState state): PushBlock(ObjCode::Player, pos, PINK, true, true, Sticky::None), state_ {state} {}
 
 Player::~Player() {}
 
+void* Player::operator new(std::size_t size) {
+    return slab_new<Player>(size);
+}
+
+void Player::operator delete(void* block, std::size_t size) {
+    slab_delete<Player>(block, size);
+}
+
 std::string Player::name() {
     return "Player";
 }
@@ -33,7 +42,7 @@ void Player::toggle_riding(RoomMap* room_map, DeltaFrame* delta_frame) {
         delta_frame->push(std::make_unique<RidingStateDelta>(this, state_));
         state_ = RidingState::Bound;
     } else if (state_ == RidingState::Bound) {
-        if (dynamic_cast<Car*>(room_map->view(shifted_pos({0,0,-1}))->modifier())) {
+        if (kind_cast<Car>(room_map->view(shifted_pos({0,0,-1}))->modifier())) {
             delta_frame->push(std::make_unique<RidingStateDelta>(this, state_));
             state_ = RidingState::Riding;
         }
@@ -45,7 +54,7 @@ Car* Player::get_car(RoomMap* room_map, bool strict) {
         return nullptr;
     } else {
         //NOTE: if there are no bugs elsewhere, this could be a static cast
-        return dynamic_cast<Car*>(room_map->view(shifted_pos({0,0,-1}))->modifier());
+        return kind_cast<Car>(room_map->view(shifted_pos({0,0,-1}))->modifier());
     }
 }
 
@@ -1,7 +1,5 @@
 #include "playingstate.h"
 
-#include <unistd.h>
-
 #include "graphicsmanager.h"
 
 #pragma GCC diagnostic push
@@ -20,13 +18,12 @@
 #include "player.h"
 #include "room.h"
 #include "roommap.h"
+#include "roommanager.h"
 #include "moveprocessor.h"
 #include "door.h"
-#include "mapfile.h"
 #include "car.h"
 
 #include "common_constants.h"
-#include "string_constants.h"
 
 const std::unordered_map<int, Point3> MOVEMENT_KEYS {
     {GLFW_KEY_RIGHT, {1, 0, 0}},
@@ -37,9 +34,10 @@ const std::unordered_map<int, Point3> MOVEMENT_KEYS {
 
 
 PlayingState::PlayingState(const std::string& name, Point3 pos, bool testing):
-    GameState(), loaded_rooms_ {}, objs_ {std::make_unique<GameObjectArray>()},
+    GameState(), objs_ {std::make_unique<GameObjectArray>()},
     move_processor_ {}, room_ {}, player_ {},
-    undo_stack_ {std::make_unique<UndoStack>(MAX_UNDO_DEPTH)},
+    undo_stack_ {std::make_unique<UndoStack>(*objs_, MAX_UNDO_DEPTH)},
+    rooms_ {std::make_unique<RoomManager>(*objs_, *undo_stack_, ROOM_RESIDENCY_BUDGET)},
     testing_ {testing} {
     activate_room(name);
     init_player(pos);
@@ -53,7 +51,7 @@ void PlayingState::init_player(Point3 pos) {
     // TODO: fix this hack
     GameObject* below = room_->map()->view({pos.x, pos.y, pos.z - 1});
     if (below) {
-        if (dynamic_cast<Car*>(below->modifier())) {
+        if (kind_cast<Car>(below->modifier())) {
             rs = RidingState::Riding;
         } else {
             rs = RidingState::Bound;
@@ -69,6 +67,8 @@ void PlayingState::init_player(Point3 pos) {
 void PlayingState::main_loop() {
     if (!move_processor_) {
         delta_frame_ = std::make_unique<DeltaFrame>();
+        // Between moves is the time to load (and unload) other rooms
+        rooms_->update(room_);
     }
     handle_input();
     room_->draw(gfx_, player_, false, false);
@@ -95,7 +95,7 @@ void PlayingState::handle_input() {
             if (move_processor_) {
                 move_processor_->abort();
                 move_processor_.reset(nullptr);
-                delta_frame_->revert();
+                delta_frame_->revert(*objs_);
                 delta_frame_ = std::make_unique<DeltaFrame>();
                 room_->map()->reset_local_state();
                 if (player_) {
@@ -133,7 +133,7 @@ void PlayingState::handle_input() {
     RoomMap* room_map = room_->map();
     // TODO: Make a real "death" flag/state
     // Don't allow other input if player is "dead"
-    if (!dynamic_cast<Player*>(room_map->view(player_->pos_))) {
+    if (!kind_cast<Player>(room_map->view(player_->pos_))) {
         return;
     }
     for (auto p : MOVEMENT_KEYS) {
@@ -163,39 +163,27 @@ void PlayingState::handle_input() {
 }
 
 bool PlayingState::activate_room(const std::string& name) {
-    if (!loaded_rooms_.count(name)) {
-        if (!load_room(name)) {
-            return false;
-        }
+    Room* room = rooms_->load_room(name);
+    if (!room) {
+        return false;
     }
-    room_ = loaded_rooms_[name].get();
+    room_ = room;
     return true;
 }
 
+// This will be much more complicated when save files are a thing
 bool PlayingState::load_room(const std::string& name) {
-    // This will be much more complicated when save files are a thing
-    std::string path = MAPS_TEMP + name + ".map";
-    if (access(path.c_str(), F_OK) == -1) {
-        path = MAPS_MAIN + name + ".map";
-        if (access(path.c_str(), F_OK) == -1) {
-            return false;
-        }
-    }
-    MapFileI file {path};
-    auto room = std::make_unique<Room>(name);
-    room->load_from_file(*objs_, file);
-    // Load dynamic component!
-    room->map()->set_initial_state(false);
-    loaded_rooms_[name] = std::move(room);
-    return true;
+    return rooms_->load_room(name) != nullptr;
 }
 
+// The RoomManager has usually built the destination by now; if it hasn't,
+// the door doesn't work until it has, rather than the move waiting on it
 bool PlayingState::can_use_door(Door* door, std::vector<GameObject*>& objs, bool* same_room) {
     MapLocation* dest = door->dest();
-    if (!loaded_rooms_.count(dest->name)) {
-        load_room(dest->name);
+    Room* dest_room = rooms_->get_room(dest->name);
+    if (!dest_room) {
+        return false;
     }
-    Room* dest_room = loaded_rooms_[dest->name].get();
     RoomMap* cur_map = room_->map();
     RoomMap* dest_map = dest_room->map();
     Point3 dest_pos_local = Point3{dest->pos} + Point3{dest_room->offset_pos_};
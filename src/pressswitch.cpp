@@ -1,5 +1,6 @@
 #include "pressswitch.h"
 
+#include "slab.h"
 #include "gameobject.h"
 #include "mapfile.h"
 #include "roommap.h"
@@ -7,10 +8,18 @@
 #include "graphicsmanager.h"
 
 PressSwitch::PressSwitch(GameObject* parent, int color, bool persistent, bool active):
-Switch(parent, persistent, active), color_ {color} {}
+Switch(parent, ModCode::PressSwitch, persistent, active), color_ {color} {}
 
 PressSwitch::~PressSwitch() {}
 
+void* PressSwitch::operator new(std::size_t size) {
+    return slab_new<PressSwitch>(size);
+}
+
+void PressSwitch::operator delete(void* block, std::size_t size) {
+    slab_delete<PressSwitch>(block, size);
+}
+
 std::string PressSwitch::name() {
     return "PressSwitch";
 }
@@ -19,14 +28,14 @@ ModCode PressSwitch::mod_code() {
     return ModCode::PressSwitch;
 }
 
-void PressSwitch::serialize(MapFileO& file) {
+void PressSwitch::serialize(MapFileO& file, GameObjectArray&) {
     file << color_ << persistent_ << active_;
 }
 
-void PressSwitch::deserialize(MapFileI& file, RoomMap*, GameObject* parent) {
+void PressSwitch::deserialize(MapFileI& file, RoomMap* room_map, GameObject* parent) {
     unsigned char b[3];
     file.read(b, 3);
-    parent->set_modifier(std::make_unique<PressSwitch>(parent, b[0], b[1], b[2]));
+    room_map->set_modifier(parent, std::make_unique<PressSwitch>(parent, b[0], b[1], b[2]));
 }
 
 void PressSwitch::check_send_signal(RoomMap* room_map, DeltaFrame* delta_frame) {
@@ -53,7 +62,7 @@ void PressSwitch::setup_on_put(RoomMap* room_map) {
 }
 
 void PressSwitch::cleanup_on_take(RoomMap* room_map) {
-    room_map->remove_listener(this, pos_above());
+    room_map->remove_listener(this);
 }
 
 void PressSwitch::draw(GraphicsManager* gfx, FPoint3 p) {
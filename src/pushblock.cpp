@@ -1,5 +1,6 @@
 #include "pushblock.h"
 
+#include "slab.h"
 #include "roommap.h"
 #include "mapfile.h"
 #include "graphicsmanager.h"
@@ -9,10 +10,22 @@
 #include "car.h"
 
 PushBlock::PushBlock(Point3 pos, int color, bool pushable, bool gravitable, Sticky sticky):
-GameObject(pos, color, pushable, gravitable), sticky_ {sticky} {}
+GameObject(ObjCode::PushBlock, pos, color, pushable, gravitable), sticky_ {sticky} {}
+
+// For subclasses
+PushBlock::PushBlock(ObjCode kind, Point3 pos, int color, bool pushable, bool gravitable, Sticky sticky):
+GameObject(kind, pos, color, pushable, gravitable), sticky_ {sticky} {}
 
 PushBlock::~PushBlock() {}
 
+void* PushBlock::operator new(std::size_t size) {
+    return slab_new<PushBlock>(size);
+}
+
+void PushBlock::operator delete(void* block, std::size_t size) {
+    slab_delete<PushBlock>(block, size);
+}
+
 std::string PushBlock::name() {
     return "PushBlock";
 }
@@ -36,8 +49,13 @@ void PushBlock::collect_sticky_links(RoomMap* room_map, Sticky sticky_level, std
     Sticky sticky_condition = sticky_ & sticky_level;
     if (sticky_condition != Sticky::None) {
         for (Point3 d : DIRECTIONS) {
-            PushBlock* adj = dynamic_cast<PushBlock*>(room_map->view(pos_ + d));
-            if (adj && adj->color_ == color_ && ((adj->sticky_ & sticky_condition) != Sticky::None)) {
+            GameObject* obj = room_map->view(pos_ + d);
+            // Every kind of object but a SnakeBlock is a PushBlock
+            if (!obj || obj->kind_ == ObjCode::SnakeBlock) {
+                continue;
+            }
+            PushBlock* adj = static_cast<PushBlock*>(obj);
+            if (adj->color_ == color_ && ((adj->sticky_ & sticky_condition) != Sticky::None)) {
                 links.push_back(adj);
             }
         }
@@ -69,9 +87,9 @@ void PushBlock::draw(GraphicsManager* gfx) {
         tex = Texture::Corners;
         break;
     }
-    if (dynamic_cast<AutoBlock*>(modifier())) {
+    if (kind_cast<AutoBlock>(modifier())) {
         tex = tex | Texture::AutoBlock;
-    } else if (dynamic_cast<Car*>(modifier())) {
+    } else if (kind_cast<Car>(modifier())) {
         tex = tex | Texture::Car;
     }
     gfx->set_tex(tex);
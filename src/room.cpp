@@ -1,6 +1,7 @@
 #include "room.h"
 
 #include <iostream>
+#include <limits>
 
 #include "roommap.h"
 #include "camera.h"
@@ -24,7 +25,7 @@
 #include "mapfile.h"
 
 Room::Room(const std::string& name): name_ {name},
-map_ {}, camera_ {}, offset_pos_ {0,0,0} {}
+map_ {}, camera_ {}, loaded_layers_ {0}, reading_objects_ {false}, offset_pos_ {0,0,0} {}
 
 Room::~Room() {}
 
@@ -107,10 +108,12 @@ void Room::shift_by(Point3 d) {
 }
 
 void Room::write_to_file(MapFileO& file, Point3 start_pos) {
+    file << MapCode::WideCoords;
+
     file << MapCode::Dimensions;
-    file << map_->width_;
-    file << map_->height_;
-    file << map_->depth_;
+    file.write_coord(map_->width_);
+    file.write_coord(map_->height_);
+    file.write_coord(map_->depth_);
 
     file << MapCode::OffsetPos;
     file << offset_pos_;
@@ -126,32 +129,51 @@ void Room::write_to_file(MapFileO& file, Point3 start_pos) {
 }
 
 void Room::load_from_file(GameObjectArray& objs, MapFileI& file, Point3* start_pos) {
+    load_part(objs, file, std::numeric_limits<unsigned int>::max(), start_pos);
+}
+
+bool Room::load_part(GameObjectArray& objs, MapFileI& file, unsigned int max_objects, Point3* start_pos) {
     unsigned char b[8];
-    bool reading_file = true;
-    while (reading_file) {
+    if (reading_objects_) {
+        reading_objects_ = !read_objects(file, max_objects);
+        if (reading_objects_) {
+            return false;
+        }
+    }
+    while (true) {
         file.read(b, 1);
         switch (static_cast<MapCode>(b[0])) {
-        case MapCode::Dimensions:
-            file.read(b, 3);
-            initialize(objs, b[0], b[1], b[2]);
+        case MapCode::WideCoords:
+            file.use_wide_coords();
             break;
-        case MapCode::FullLayer: // These codes are useless for now!
-            //map_->push_full();
+        case MapCode::Dimensions: {
+            int width = file.read_coord();
+            int height = file.read_coord();
+            int depth = file.read_coord();
+            initialize(objs, width, height, depth);
             break;
+        }
+        // The map was already given depth_ layers; these just pick their types
+        case MapCode::FullLayer:
         case MapCode::SparseLayer:
-            //map_->push_sparse();
+        case MapCode::ChunkedLayer:
+            map_->set_layer_type(loaded_layers_++, static_cast<MapCode>(b[0]));
             break;
-        case MapCode::DefaultPos:
-            file.read(b, 3);
+        case MapCode::DefaultPos: {
+            Point3 pos {file.read_point3()};
             if (start_pos) {
-                *start_pos = {b[0], b[1], b[2]};
+                *start_pos = pos;
             }
             break;
+        }
         case MapCode::OffsetPos:
             file >> offset_pos_;
             break;
         case MapCode::Objects:
-            read_objects(file);
+            reading_objects_ = !read_objects(file, max_objects);
+            if (reading_objects_) {
+                return false;
+            }
             break;
         case MapCode::CameraRects:
             read_camera_rects(file);
@@ -168,12 +190,14 @@ void Room::load_from_file(GameObjectArray& objs, MapFileI& file, Point3* start_p
         case MapCode::Walls:
             read_walls(file);
             break;
+        case MapCode::WallRuns:
+            read_wall_runs(file);
+            break;
         case MapCode::PlayerData:
             read_player_data(file);
             break;
         case MapCode::End:
-            reading_file = false;
-            break;
+            return true;
         default :
             std::cout << "unknown state code! " << (int)b[0] << std::endl;
             //throw std::runtime_error("Unknown State code encountered in .map file (it's probably corrupt/an old version)");
@@ -192,14 +216,18 @@ case ObjCode::CLASS:\
 
 #define CASE_MODCODE(CLASS)\
 case ModCode::CLASS:\
-    CLASS::deserialize(file, map_.get(), obj.get());\
+    CLASS::deserialize(file, map_.get(), parent);\
     break;
 
 
-void Room::read_objects(MapFileI& file) {
+// Returns true at the end of the section, false if it ran out of objects first
+// Each object is created before its modifier is read, so that the modifier
+// (and anything it creates, like a GateBody) can refer to its handle
+bool Room::read_objects(MapFileI& file, unsigned int& max_objects) {
     unsigned char b;
     std::unique_ptr<GameObject> obj {};
-    while (true) {
+    GameObject* parent {};
+    while (max_objects > 0) {
         obj = nullptr;
         file.read(&b, 1);
         switch (static_cast<ObjCode>(b)) {
@@ -211,11 +239,13 @@ void Room::read_objects(MapFileI& file) {
         case ObjCode::Player:
             break;
         case ObjCode::NONE:
-            return;
+            return true;
         default:
             throw std::runtime_error("Unknown Object code encountered in .map file (it's probably corrupt/an old version)");
             break;
         }
+        parent = obj.get();
+        map_->create(std::move(obj), nullptr);
         file.read(&b, 1);
         switch (static_cast<ModCode>(b)) {
         CASE_MODCODE(Car)
@@ -229,8 +259,9 @@ void Room::read_objects(MapFileI& file) {
             throw std::runtime_error("Unknown Modifier code encountered in .map file (it's probably corrupt/an old version)");
             break;
         }
-        map_->create(std::move(obj), nullptr);
+        --max_objects;
     }
+    return false;
 }
 
 #undef CASE_OBJCODE
@@ -264,16 +295,16 @@ void Room::read_camera_rects(MapFileI& file) {
 #undef CASE_CAMCODE
 
 void Room::read_snake_link(MapFileI& file) {
-    unsigned char b[4];
-    file.read(b, 4);
-    SnakeBlock* sb = static_cast<SnakeBlock*>(map_->view({b[0], b[1], b[2]}));
+    Point3 pos {file.read_point3()};
+    unsigned char links = file.read_byte();
+    SnakeBlock* sb = static_cast<SnakeBlock*>(map_->view(pos));
     // Linked right
-    if (b[3] & 1) {
-        sb->add_link_quiet(static_cast<SnakeBlock*>(map_->view({b[0]+1, b[1], b[2]})));
+    if (links & 1) {
+        sb->add_link_quiet(static_cast<SnakeBlock*>(map_->view(pos + Point3{1, 0, 0})));
     }
     // Linked down
-    if (b[3] & 2) {
-        sb->add_link_quiet(static_cast<SnakeBlock*>(map_->view({b[0], b[1]+1, b[2]})));
+    if (links & 2) {
+        sb->add_link_quiet(static_cast<SnakeBlock*>(map_->view(pos + Point3{0, 1, 0})));
     }
 }
 
@@ -310,6 +341,23 @@ void Room::read_walls(MapFileI& file) {
     Point3 pos;
     for (int i = 0; i < b[0]; ++i) {
         file >> pos;
+        map_->create_wall(pos);
+    }
+}
+
+void Room::read_wall_runs(MapFileI& file) {
+    while (true) {
+        int y = file.read_coord();
+        int z = file.read_coord();
+        int n_runs = file.read_coord();
+        if (!n_runs) {
+            return;
+        }
+        for (int i = 0; i < n_runs; ++i) {
+            int x = file.read_coord();
+            int length = file.read_coord();
+            map_->create_wall_run({x, y, z}, length);
+        }
     }
 }
 
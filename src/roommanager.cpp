@@ -0,0 +1,266 @@
+#include "roommanager.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "room.h"
+#include "roommap.h"
+#include "dirtytracker.h"
+#include "gameobject.h"
+#include "door.h"
+#include "delta.h"
+#include "mapfile.h"
+#include "movearena.h"
+
+#include "common_constants.h"
+#include "string_constants.h"
+
+// This runs on a worker thread, so it mustn't touch anything but the disk
+static std::string read_map_file(const std::string& name) {
+    std::string path = MAPS_TEMP + name + ".map";
+    if (access(path.c_str(), F_OK) == -1) {
+        path = MAPS_MAIN + name + ".map";
+        if (access(path.c_str(), F_OK) == -1) {
+            return "";
+        }
+    }
+    std::ifstream file {path, std::ios::in | std::ios::binary};
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+RoomManager::RoomManager(GameObjectArray& objs, UndoStack& undo_stack, std::size_t budget):
+objs_ {objs}, undo_stack_ {undo_stack}, budget_ {budget},
+rooms_ {}, lru_ {}, prefetches_ {}, snapshots_ {}, snapshot_bytes_ {0}, build_ {}, wanted_ {},
+active_room_ {}, door_dests_ {} {}
+
+RoomManager::~RoomManager() {}
+
+RoomManager::PendingBuild::PendingBuild(const std::string& name_arg, std::string bytes_arg):
+name {name_arg}, bytes {std::move(bytes_arg)}, stream {bytes},
+file {std::make_unique<MapFileI>(stream)}, room {std::make_unique<Room>(name_arg)}, loaded {false} {}
+
+RoomManager::PendingBuild::~PendingBuild() {}
+
+Room* RoomManager::get_room(const std::string& name) {
+    auto it = rooms_.find(name);
+    if (it != rooms_.end()) {
+        wanted_.erase(std::remove(wanted_.begin(), wanted_.end(), name), wanted_.end());
+        return it->second.room.get();
+    }
+    push_unique(wanted_, name);
+    if (!snapshots_.count(name) && !(build_ && build_->name == name)) {
+        prefetch(name);
+    }
+    return nullptr;
+}
+
+Room* RoomManager::load_room(const std::string& name) {
+    if (!rooms_.count(name)) {
+        if (build_ && build_->name == name) {
+            while (!build_->loaded) {
+                advance_build();
+            }
+            advance_build();
+        } else {
+            std::string bytes;
+            if (!take_ready_bytes(name, bytes)) {
+                if (prefetches_.count(name)) {
+                    bytes = prefetches_[name].get();
+                    prefetches_.erase(name);
+                } else {
+                    bytes = read_map_file(name);
+                }
+            }
+            if (bytes.empty()) {
+                return nullptr;
+            }
+            auto room = build_room(name, bytes);
+            make_resident(name, std::move(room), std::move(bytes));
+        }
+    }
+    return rooms_[name].room.get();
+}
+
+void RoomManager::update(Room* active_room) {
+    if (active_room != active_room_) {
+        // The frame in progress may still move things out of the old room
+        if (active_room_) {
+            rooms_[active_room_->name()].frames_end = undo_stack_.next_frame() + 1;
+        }
+        active_room_ = active_room;
+        touch(active_room->name());
+        prefetch_doors(active_room);
+    }
+    advance_build();
+    evict_over_budget(active_room);
+}
+
+std::unique_ptr<Room> RoomManager::build_room(const std::string& name, const std::string& bytes) {
+    std::istringstream stream {bytes};
+    MapFileI file {stream};
+    auto room = std::make_unique<Room>(name);
+    room->load_from_file(objs_, file);
+    // Load dynamic component!
+    room->map()->set_initial_state(false);
+    return room;
+}
+
+void RoomManager::make_resident(const std::string& name, std::unique_ptr<Room> room, std::string bytes) {
+    unsigned int generation = room->map()->dirty_tracker()->generation();
+    lru_.push_front(name);
+    std::size_t room_bytes = room->map()->memory_usage() + bytes.capacity();
+    rooms_[name] = {std::move(room), lru_.begin(), 0, std::move(bytes), generation, room_bytes, generation};
+}
+
+void RoomManager::touch(const std::string& name) {
+    ResidentRoom& resident = rooms_[name];
+    lru_.erase(resident.lru_pos);
+    lru_.push_front(name);
+    resident.lru_pos = lru_.begin();
+}
+
+void RoomManager::prefetch_doors(Room* room) {
+    door_dests_.clear();
+    room->map()->for_each_modifier<Door>([this](Door* door) {
+        if (!door->dest()) {
+            return;
+        }
+        const std::string& name = door->dest()->name;
+        door_dests_.push_back(name);
+        if (!rooms_.count(name) && !snapshots_.count(name)) {
+            prefetch(name);
+        }
+    });
+}
+
+void RoomManager::prefetch(const std::string& name) {
+    if (!prefetches_.count(name)) {
+        prefetches_[name] = std::async(std::launch::async, read_map_file, name);
+    }
+}
+
+// Either the room's snapshot, or its file if that's finished being read
+bool RoomManager::take_ready_bytes(const std::string& name, std::string& bytes) {
+    auto snapshot = snapshots_.find(name);
+    if (snapshot != snapshots_.end()) {
+        bytes = std::move(snapshot->second);
+        snapshots_.erase(snapshot);
+        snapshot_bytes_ -= bytes.size();
+        return true;
+    }
+    auto it = prefetches_.find(name);
+    if (it != prefetches_.end() && it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        bytes = it->second.get();
+        prefetches_.erase(it);
+        return true;
+    }
+    return false;
+}
+
+// Rooms that were asked for go first, then door destinations as they're read
+void RoomManager::start_build() {
+    std::string bytes;
+    for (std::string& name : wanted_) {
+        if (take_ready_bytes(name, bytes)) {
+            if (bytes.empty()) {
+                // There's no such room; let the next get_room look again
+                wanted_.erase(std::find(wanted_.begin(), wanted_.end(), name));
+            } else {
+                build_ = std::make_unique<PendingBuild>(name, std::move(bytes));
+            }
+            return;
+        }
+    }
+    for (auto it = prefetches_.begin(); it != prefetches_.end(); ++it) {
+        if (it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            std::string name = it->first;
+            bytes = it->second.get();
+            prefetches_.erase(it);
+            if (!bytes.empty()) {
+                build_ = std::make_unique<PendingBuild>(name, std::move(bytes));
+            }
+            return;
+        }
+    }
+}
+
+// Each call does one slice of the build: some objects, or the initial
+// state once everything's loaded
+void RoomManager::advance_build() {
+    if (!build_) {
+        start_build();
+    } else if (!build_->loaded) {
+        build_->loaded = build_->room->load_part(objs_, *build_->file, ROOM_BUILD_SLICE);
+    } else {
+        // Load dynamic component!
+        build_->room->map()->set_initial_state(false);
+        make_resident(build_->name, std::move(build_->room), std::move(build_->bytes));
+        build_.reset(nullptr);
+    }
+}
+
+// Layers change representation and grow as rooms are played in, so a room
+// is measured again whenever its dirty generation has moved on (which in
+// practice means the active room, once per move)
+std::size_t RoomManager::measure(ResidentRoom& resident) {
+    unsigned int generation = resident.room->map()->dirty_tracker()->generation();
+    if (generation != resident.measured_generation) {
+        resident.bytes = resident.room->map()->memory_usage() + resident.source.capacity();
+        resident.measured_generation = generation;
+    }
+    return resident.bytes;
+}
+
+void RoomManager::evict_over_budget(Room* active_room) {
+    std::size_t resident_bytes = snapshot_bytes_;
+    for (auto& p : rooms_) {
+        resident_bytes += measure(p.second);
+    }
+    auto it = lru_.end();
+    while (resident_bytes > budget_ && it != lru_.begin()) {
+        --it;
+        if (can_evict(*it, active_room)) {
+            std::string name = *it;
+            // it is about to be invalidated, so step forward first
+            ++it;
+            resident_bytes -= rooms_[name].bytes;
+            evict(name);
+            resident_bytes += snapshots_[name].size();
+        }
+    }
+}
+
+// The undo stack may hold pointers into any room it has seen recently,
+// and a room that was asked for should stay until get_room hands it out
+bool RoomManager::can_evict(const std::string& name, Room* active_room) {
+    ResidentRoom& resident = rooms_[name];
+    return resident.room.get() != active_room &&
+        resident.frames_end <= undo_stack_.oldest_frame() &&
+        std::find(door_dests_.begin(), door_dests_.end(), name) == door_dests_.end() &&
+        std::find(wanted_.begin(), wanted_.end(), name) == wanted_.end();
+}
+
+void RoomManager::evict(const std::string& name) {
+    ResidentRoom& resident = rooms_[name];
+    // A room nothing has happened in (most often, a prefetched door
+    // destination that was never visited) doesn't need serializing again
+    if (resident.room->map()->dirty_tracker()->generation() == resident.built_generation) {
+        snapshots_[name] = std::move(resident.source);
+    } else {
+        std::ostringstream stream {};
+        {
+            MapFileO file {stream};
+            resident.room->write_to_file(file, {0,0,0});
+        }
+        snapshots_[name] = stream.str();
+    }
+    snapshot_bytes_ += snapshots_[name].size();
+    resident.room->map()->release_objects();
+    lru_.erase(resident.lru_pos);
+    rooms_.erase(name);
+}
@@ -5,24 +5,45 @@
 #include "gameobjectarray.h"
 #include "gameobject.h"
 #include "delta.h"
+#include "pushblock.h"
 #include "snakeblock.h"
+#include "gatebody.h"
+#include "player.h"
 #include "switch.h"
+#include "car.h"
+#include "door.h"
+#include "gate.h"
+#include "pressswitch.h"
+#include "autoblock.h"
 #include "signaler.h"
 #include "mapfile.h"
 #include "objectmodifier.h"
 #include "maplayer.h"
 #include "effects.h"
+#include "dirtytracker.h"
+#include "stickycache.h"
 #include "moveprocessor.h"
+#include "movearena.h"
 #include "common_constants.h"
 
+unsigned int RoomMap::next_listener_gen_ = 0;
+
 RoomMap::RoomMap(GameObjectArray& obj_array, int width, int height, int depth):
-agents_ {}, obj_array_ {obj_array},
+agents_ {&GameObject::agent_slot_}, snakes_ {&SnakeBlock::snake_slot_},
+gravitables_ {&GameObject::gravitable_slot_},
+modifiers_ (MOD_CODE_COUNT, ObjectIndex<ObjectModifier> {&ObjectModifier::index_slot_}), abstract_objs_ {},
+obj_array_ {obj_array},
 width_ {width}, height_ {height}, depth_ {},
-layers_ {}, listeners_ {}, signalers_ {},
-effects_ {std::make_unique<Effects>()} {
-    // TODO: Eventually, fix the way that maplayers are chosen
+layers_ {}, walls_ {std::make_unique<BitLayer>(width, height, depth)},
+columns_ {std::make_unique<ColumnIndex>(width, height, depth)},
+listener_flags_ {std::make_unique<BitLayer>(width, height, depth)}, listeners_ {}, signalers_ {}, dirty_signalers_ {},
+activated_listeners_ (MOD_CODE_COUNT), listener_gen_ {++next_listener_gen_},
+events_ {}, moved_modifiers_ (MOD_CODE_COUNT), event_gen_ {++next_listener_gen_}, support_changes_ {}, records_support_ {true},
+effects_ {std::make_unique<Effects>()}, dirty_ {std::make_unique<DirtyTracker>()},
+sticky_cache_ {std::make_unique<StickyCache>(this)} {
     for (int i = 0; i < depth; ++i) {
-        push_full();
+        layers_.push_back(make_layer(dense_layer_type()));
+        ++depth_;
     }
 }
 
@@ -43,14 +64,103 @@ bool RoomMap::valid(Point3 pos) {
     return (0 <= pos.x) && (pos.x < width_) && (0 <= pos.y) && (pos.y < height_) && (0 <= pos.z) && (pos.z < depth_);
 }
 
-void RoomMap::push_full() {
-    layers_.push_back(std::make_unique<FullMapLayer>(this, width_, height_));
-    ++depth_;
+std::unique_ptr<MapLayer> RoomMap::make_layer(MapCode type) {
+    if (type == MapCode::SparseLayer) {
+        return std::make_unique<SparseMapLayer>(this);
+    } else if (type == MapCode::ChunkedLayer) {
+        return std::make_unique<ChunkedMapLayer>(this, width_, height_);
+    } else {
+        return std::make_unique<FullMapLayer>(this, width_, height_);
+    }
+}
+
+// Large rooms only pay for the parts of each layer that are occupied
+MapCode RoomMap::dense_layer_type() {
+    if (width_*height_ >= CHUNKED_LAYER_MIN_AREA) {
+        return MapCode::ChunkedLayer;
+    } else {
+        return MapCode::FullLayer;
+    }
+}
+
+void RoomMap::set_layer_type(int z, MapCode type) {
+    if (layers_[z]->type() == type) {
+        return;
+    }
+    auto layer = make_layer(type);
+    layers_[z]->copy_into(*layer);
+    layers_[z] = std::move(layer);
+}
+
+// Only call this when no layer is in the middle of for_each_in_rect!
+void RoomMap::update_layer_types() {
+    int area = width_*height_;
+    for (int z = 0; z < depth_; ++z) {
+        int count = layers_[z]->count();
+        if (layers_[z]->type() == MapCode::SparseLayer) {
+            if (count*SPARSE_LAYER_EXIT_RATIO > area) {
+                set_layer_type(z, dense_layer_type());
+            }
+        } else if (count*SPARSE_LAYER_ENTER_RATIO < area) {
+            set_layer_type(z, MapCode::SparseLayer);
+        }
+    }
+}
+
+// An object and its modifier, which come from their slabs
+static std::size_t object_memory_usage(GameObject* obj) {
+    std::size_t bytes = sizeof(GameObject);
+    if (obj->kind_ == ObjCode::PushBlock) {
+        bytes = sizeof(PushBlock);
+    } else if (kind_cast<SnakeBlock>(obj)) {
+        bytes = sizeof(SnakeBlock);
+    } else if (kind_cast<GateBody>(obj)) {
+        bytes = sizeof(GateBody);
+    } else if (kind_cast<Player>(obj)) {
+        bytes = sizeof(Player);
+    }
+    ObjectModifier* mod = obj->modifier();
+    if (!mod) {
+        return bytes;
+    }
+    if (kind_cast<Car>(mod)) {
+        bytes += sizeof(Car);
+    } else if (Door* door = kind_cast<Door>(mod)) {
+        bytes += sizeof(Door);
+        if (door->dest()) {
+            bytes += sizeof(MapLocation) + door->dest()->name.capacity();
+        }
+    } else if (kind_cast<Gate>(mod)) {
+        bytes += sizeof(Gate);
+    } else if (kind_cast<PressSwitch>(mod)) {
+        bytes += sizeof(PressSwitch);
+    } else if (kind_cast<AutoBlock>(mod)) {
+        bytes += sizeof(AutoBlock);
+    } else {
+        bytes += sizeof(ObjectModifier);
+    }
+    return bytes;
 }
 
-void RoomMap::push_sparse() {
-    layers_.push_back(std::make_unique<SparseMapLayer>(this));
-    ++depth_;
+// This visits every object, so it's for when the room has changed, not every frame
+std::size_t RoomMap::memory_usage() {
+    std::size_t bytes = walls_->memory_usage() + columns_->memory_usage() + listener_flags_->memory_usage();
+    for (auto& layer : layers_) {
+        bytes += layer->memory_usage();
+    }
+    for_each_in_rect(MapRect{0,0,width_,height_}, [&bytes, this](int id) {
+        bytes += object_memory_usage(obj_array_[id]);
+    });
+    for (GameObject* obj : abstract_objs_) {
+        if (!obj->tangible_) {
+            bytes += object_memory_usage(obj);
+        }
+    }
+    for (auto& signaler : signalers_) {
+        bytes += sizeof(Signaler) + signaler->label_.capacity() +
+            sizeof(GameObjectHandle) * (signaler->switches_.capacity() + signaler->switchables_.capacity());
+    }
+    return bytes;
 }
 
 struct ObjectSerializationHandler {
@@ -78,7 +188,7 @@ void ObjectSerializationHandler::operator()(int id) {
     obj->serialize(file);
     if (ObjectModifier* mod = obj->modifier()) {
         file << mod->mod_code();
-        mod->serialize(file);
+        mod->serialize(file, obj_array);
         if (mod->relation_check()) {
             rel_check_mods.push_back(mod);
         }
@@ -98,19 +208,16 @@ void RoomMap::serialize(MapFileO& file) const {
 
     std::vector<GameObject*> rel_check_objs {};
     std::vector<ObjectModifier*> rel_check_mods {};
-    GameObjIDFunc ser_handler = ObjectSerializationHandler{obj_array_, file, rel_check_objs, rel_check_mods};
+    ObjectSerializationHandler ser_handler {obj_array_, file, rel_check_objs, rel_check_mods};
     // Serialize raw object data
     file << MapCode::Objects;
-    for (auto& layer : layers_) {
-        layer->apply_to_rect(MapRect{0,0,width_,height_}, ser_handler);
-    }
+    for_each_in_rect(MapRect{0,0,width_,height_}, ser_handler);
     file << ObjCode::NONE;
-    // TODO: Actually Serialize Wall positions
-    file << MapCode::Walls;
-    file << 0;
+    file << MapCode::WallRuns;
+    walls_->serialize(file);
     // Serialize relational data
     for (auto obj : rel_check_objs) {
-        obj->relation_serialize(file);
+        obj->relation_serialize(file, obj_array_);
     }
     for (auto mod : rel_check_mods) {
         mod->relation_serialize(file);
@@ -121,41 +228,79 @@ void RoomMap::serialize(MapFileO& file) const {
     }
 }
 
-int& RoomMap::at(Point3 pos) {
+int RoomMap::at(Point3 pos) {
     return layers_[pos.z]->at(pos.h());
 }
 
+void RoomMap::set(Point3 pos, int id) {
+    layers_[pos.z]->set(pos.h(), id);
+    columns_->set(pos, id || walls_->at(pos));
+}
+
 // Pretend that every out-of-bounds "object" is a Wall, unless it's below the map
 GameObject* RoomMap::view(Point3 pos) {
     if (pos.z < 0) {
         return nullptr;
     } else if (valid(pos)) {
-        return obj_array_[layers_[pos.z]->at(pos.h())];
+        if (int id = layers_[pos.z]->at(pos.h())) {
+            return obj_array_[id];
+        } else if (walls_->at(pos)) {
+            return obj_array_[GLOBAL_WALL_ID];
+        }
+        return nullptr;
     } else {
         return obj_array_[GLOBAL_WALL_ID];
     }
 }
 
+// The same as view, but without looking at the object itself
+int RoomMap::id_at(Point3 pos) {
+    if (pos.z < 0) {
+        return 0;
+    } else if (valid(pos)) {
+        if (int id = layers_[pos.z]->at(pos.h())) {
+            return id;
+        } else if (walls_->at(pos)) {
+            return GLOBAL_WALL_ID;
+        }
+        return 0;
+    } else {
+        return GLOBAL_WALL_ID;
+    }
+}
+
+int RoomMap::highest_below(Point3 pos) {
+    return columns_->highest_below(pos);
+}
+
+// Every change to the map's contents, including undoing one, goes through these two
+// Setting up and cleaning up modifiers waits until flush_events
 void RoomMap::just_take(GameObject* obj) {
-    obj->cleanup_on_take(this);
+    sticky_cache_->invalidate(obj);
     obj->tangible_ = false;
-    at(obj->pos_) -= obj->id_;
+    set(obj->pos_, at(obj->pos_) - obj->id_);
+    dirty_->mark(obj->pos_);
+    record_support_change({obj->pos_, 0, obj->sticky() != Sticky::None});
+    record_moved(obj);
 }
 
 void RoomMap::just_put(GameObject* obj) {
-    at(obj->pos_) += obj->id_;
-    obj->setup_on_put(this);
+    set(obj->pos_, at(obj->pos_) + obj->id_);
+    dirty_->mark(obj->pos_);
+    record_support_change({obj->pos_, obj->id_, false});
     obj->tangible_ = true;
+    sticky_cache_->invalidate(obj);
+    record_moved(obj);
 }
 
 void RoomMap::take(GameObject* obj) {
-    activate_listeners_at(obj->pos_);
+    events_.push_back({MapEventType::CellVacated, obj, obj->pos_});
     just_take(obj);
 }
 
 void RoomMap::put(GameObject* obj) {
     just_put(obj);
-    activate_listeners_at(obj->pos_);
+    events_.push_back({MapEventType::CellEntered, obj, obj->pos_});
 }
 
 void RoomMap::take_loud(GameObject* obj, DeltaFrame* delta_frame) {
@@ -176,14 +321,14 @@ void RoomMap::shift(GameObject* obj, Point3 dpos, DeltaFrame* delta_frame) {
     delta_frame->push(std::make_unique<MotionDelta>(obj, dpos, this));
 }
 
-void RoomMap::batch_shift(std::vector<GameObject*> objs, Point3 dpos, DeltaFrame* delta_frame) {
+void RoomMap::batch_shift(const std::vector<GameObject*>& objs, Point3 dpos, DeltaFrame* delta_frame) {
     for (auto obj : objs) {
         obj->set_linear_animation(dpos);
         take(obj);
         obj->pos_ += dpos;
         put(obj);
     }
-    delta_frame->push(std::make_unique<BatchMotionDelta>(std::move(objs), dpos, this));
+    delta_frame->push(std::make_unique<BatchMotionDelta>(objs, dpos, this));
 }
 
 // "just" means "don't do any checks, animations, deltas"
@@ -193,7 +338,7 @@ void RoomMap::just_shift(GameObject* obj, Point3 dpos) {
     just_put(obj);
 }
 
-void RoomMap::just_batch_shift(std::vector<GameObject*> objs, Point3 dpos) {
+void RoomMap::just_batch_shift(const std::vector<GameObject*>& objs, Point3 dpos) {
     for (auto obj : objs) {
         just_take(obj);
         obj->pos_ += dpos;
@@ -206,95 +351,297 @@ void RoomMap::create(std::unique_ptr<GameObject> obj_unique, DeltaFrame* delta_f
     // Need to push it into the GameObjectArray first to give it an ID
     obj_array_.push_object(std::move(obj_unique));
     put(obj);
-    if (obj->is_agent()) {
-        agents_.push_back(obj);
-    }
+    add_to_indices(obj);
     if (delta_frame) {
         delta_frame->push(std::make_unique<CreationDelta>(obj, this));
     }
 }
 
 void RoomMap::create_abstract(std::unique_ptr<GameObject> obj_unique, DeltaFrame* delta_frame) {
+    GameObject* obj = obj_unique.get();
+    obj_array_.push_object(std::move(obj_unique));
+    add_to_indices(obj);
+    abstract_objs_.push_back(obj);
     if (delta_frame) {
-        delta_frame->push(std::make_unique<AbstractCreationDelta>(obj_unique.get(), this));
+        delta_frame->push(std::make_unique<AbstractCreationDelta>(obj, this));
     }
-    if (obj_unique->is_agent()) {
-        agents_.push_back(obj_unique.get());
-    }
-    obj_array_.push_object(std::move(obj_unique));
 }
 
 void RoomMap::create_wall(Point3 pos) {
-    at(pos) = GLOBAL_WALL_ID;
+    walls_->set(pos, true);
+    columns_->set(pos, true);
+    dirty_->mark(pos);
 }
 
-void RoomMap::uncreate(GameObject* obj) {
-    if (obj->is_agent()) {
-        remove_agent(obj);
+void RoomMap::create_wall_run(Point3 start, int length) {
+    walls_->fill_run(start, length);
+    for (int i = 0; i < length; ++i) {
+        columns_->set(start + Point3{i, 0, 0}, true);
+        dirty_->mark(start + Point3{i, 0, 0});
     }
+}
+
+void RoomMap::remove_wall(Point3 pos) {
+    walls_->set(pos, false);
+    columns_->set(pos, at(pos) != 0);
+    dirty_->mark(pos);
+}
+
+void RoomMap::uncreate(GameObject* obj) {
+    remove_from_indices(obj);
     just_take(obj);
+    forget_events_of(obj);
     obj->cleanup_on_destruction(this);
     obj_array_.destroy(obj);
 }
 
 void RoomMap::uncreate_abstract(GameObject* obj) {
-    if (obj->is_agent()) {
-        remove_agent(obj);
-    }
+    remove_from_indices(obj);
+    abstract_objs_.erase(std::remove(abstract_objs_.begin(), abstract_objs_.end(), obj), abstract_objs_.end());
+    forget_events_of(obj);
     obj->cleanup_on_destruction(this);
     obj_array_.destroy(obj);
 }
 
+// From here on, the DeletionDelta (if any) is responsible for freeing obj.
+// Unlike taking and putting, destruction isn't queued for flush_events:
+// cleanup_on_destruction cuts the object out of its signalers (and a Gate
+// from its body), and the rest of the move mustn't see those relations.
+// uncreate frees the object outright, so it drops whatever was queued for it.
 void RoomMap::destroy(GameObject* obj, DeltaFrame* delta_frame) {
-    if (obj->is_agent()) {
-        remove_agent(obj);
-    }
+    remove_from_indices(obj);
     obj->cleanup_on_destruction(this);
     take(obj);
+    auto abs_it = std::find(abstract_objs_.begin(), abstract_objs_.end(), obj);
+    bool abstract = abs_it != abstract_objs_.end();
+    if (abstract) {
+        abstract_objs_.erase(abs_it);
+    }
     if (delta_frame) {
-        delta_frame->push(std::make_unique<DeletionDelta>(obj, this));
+        delta_frame->push(std::make_unique<DeletionDelta>(obj, this, abstract));
     }
 }
 
-void RoomMap::undestroy(GameObject* obj) {
+void RoomMap::undestroy(GameObject* obj, bool abstract) {
     just_put(obj);
     obj->setup_on_undestruction(this);
+    add_to_indices(obj);
+    if (abstract) {
+        abstract_objs_.push_back(obj);
+    }
+}
+
+// Modifiers which refer to their parent's handle are set after it's created;
+// the editor also changes them, so obj may change kinds
+void RoomMap::set_modifier(GameObject* obj, std::unique_ptr<ObjectModifier> mod) {
+    remove_from_indices(obj);
+    if (ObjectModifier* old_mod = obj->modifier()) {
+        remove_listener(old_mod);
+        forget_moved(old_mod);
+    }
+    obj->set_modifier(std::move(mod));
+    add_to_indices(obj);
+    if (obj->tangible_) {
+        record_moved(obj);
+    }
+}
+
+// Free every object in the room, for when the whole room is going away;
+// the map can't be used after this.  Objects which were taken or destroyed
+// are only kept alive for the sake of undo, so they're left alone.
+void RoomMap::release_objects() {
+    std::vector<GameObject*> objs {};
+    for_each_in_rect(MapRect{0,0,width_,height_}, [&objs, this](int id) {
+        objs.push_back(obj_array_[id]);
+    });
+    for (GameObject* obj : abstract_objs_) {
+        if (!obj->tangible_) {
+            objs.push_back(obj);
+        }
+    }
+    events_.clear();
+    for (auto& mods : moved_modifiers_) {
+        mods.clear();
+    }
+    support_changes_.clear();
+    sticky_cache_->reset();
+    agents_.clear();
+    snakes_.clear();
+    gravitables_.clear();
+    for (auto& mods : modifiers_) {
+        mods.clear();
+    }
+    abstract_objs_.clear();
+    for (GameObject* obj : objs) {
+        obj_array_.destroy(obj);
+    }
+}
+
+void RoomMap::add_to_indices(GameObject* obj) {
     if (obj->is_agent()) {
-        agents_.push_back(obj);
+        agents_.push(obj);
+    }
+    if (SnakeBlock* sb = kind_cast<SnakeBlock>(obj)) {
+        snakes_.push(sb);
+    }
+    if (obj->gravitable_) {
+        gravitables_.push(obj);
+    }
+    if (ObjectModifier* mod = obj->modifier()) {
+        modifiers_[static_cast<int>(mod->kind_)].push(mod);
     }
 }
 
-void RoomMap::remove_agent(GameObject* obj) {
-    agents_.erase(std::remove(agents_.begin(), agents_.end(), obj), agents_.end());
+void RoomMap::remove_from_indices(GameObject* obj) {
+    if (obj->is_agent()) {
+        agents_.erase(obj);
+    }
+    if (SnakeBlock* sb = kind_cast<SnakeBlock>(obj)) {
+        snakes_.erase(sb);
+    }
+    if (obj->gravitable_) {
+        gravitables_.erase(obj);
+    }
+    if (ObjectModifier* mod = obj->modifier()) {
+        modifiers_[static_cast<int>(mod->kind_)].erase(mod);
+    }
 }
 
+// A modifier listens at one position at a time; re-adding it where it
+// already is costs nothing
 void RoomMap::add_listener(ObjectModifier* obj, Point3 pos) {
+    if (obj->listening_) {
+        if (obj->listen_pos_ == pos) {
+            return;
+        }
+        remove_listener(obj);
+    }
     listeners_[pos].push_back(obj);
+    if (valid(pos)) {
+        listener_flags_->set(pos, true);
+    }
+    obj->listening_ = true;
+    obj->listen_pos_ = pos;
 }
 
-void RoomMap::remove_listener(ObjectModifier* obj, Point3 pos) {
+void RoomMap::remove_listener(ObjectModifier* obj) {
+    if (!obj->listening_) {
+        return;
+    }
+    obj->listening_ = false;
+    Point3 pos = obj->listen_pos_;
     auto& cur_lis = listeners_[pos];
     cur_lis.erase(std::remove(cur_lis.begin(), cur_lis.end(), obj), cur_lis.end());
     if (cur_lis.size() == 0) {
         listeners_.erase(pos);
+        if (valid(pos)) {
+            listener_flags_->set(pos, false);
+        }
+    }
+}
+
+void RoomMap::rebuild_listener_flags() {
+    listener_flags_ = std::make_unique<BitLayer>(width_, height_, depth_);
+    for (auto& p : listeners_) {
+        if (valid(p.first)) {
+            listener_flags_->set(p.first, true);
+        }
     }
 }
 
 void RoomMap::activate_listener_of(ObjectModifier* obj) {
-    activated_listeners_.insert(obj);
+    if (obj->activated_gen_ != listener_gen_) {
+        obj->activated_gen_ = listener_gen_;
+        activated_listeners_[static_cast<int>(obj->kind_)].push_back(obj);
+    }
 }
 
 
+// Only called with positions in the map, where objects are taken and put
 void RoomMap::activate_listeners_at(Point3 pos) {
-    if (listeners_.count(pos)) {
-        auto& cur_lis = listeners_[pos];
-        activated_listeners_.insert(cur_lis.begin(), cur_lis.end());
+    if (listener_flags_->at(pos)) {
+        for (ObjectModifier* obj : listeners_[pos]) {
+            activate_listener_of(obj);
+        }
+    }
+}
+
+// Moves the listener of every moved T to where its object now is
+template <typename T>
+void RoomMap::settle_listeners() {
+    for (ObjectModifier* mod : moved_modifiers_[static_cast<int>(T::KIND)]) {
+        if (mod->parent_->tangible_) {
+            static_cast<T*>(mod)->setup_on_put(this);
+        } else {
+            static_cast<T*>(mod)->cleanup_on_take(this);
+        }
+    }
+}
+
+// Modifiers settle their listeners first, a kind at a time, so that the
+// cells which were entered and vacated activate whoever is listening there now.
+// The net effect is the same as doing each of these as it happened.
+void RoomMap::flush_events() {
+    settle_listeners<Door>();
+    settle_listeners<PressSwitch>();
+    settle_listeners<Gate>();
+    for (auto& mods : moved_modifiers_) {
+        mods.clear();
+    }
+    event_gen_ = ++next_listener_gen_;
+    for (MapEvent& event : events_) {
+        activate_listeners_at(event.pos);
+    }
+    events_.clear();
+}
+
+void RoomMap::record_moved(GameObject* obj) {
+    ObjectModifier* mod = obj->modifier();
+    if (mod && mod->moved_gen_ != event_gen_) {
+        mod->moved_gen_ = event_gen_;
+        moved_modifiers_[static_cast<int>(mod->kind_)].push_back(mod);
+    }
+}
+
+// For a modifier which is about to be freed
+void RoomMap::forget_moved(ObjectModifier* mod) {
+    auto& mods = moved_modifiers_[static_cast<int>(mod->kind_)];
+    mods.erase(std::remove(mods.begin(), mods.end(), mod), mods.end());
+}
+
+// The object is about to be freed, so nothing may refer to it afterwards
+void RoomMap::forget_events_of(GameObject* obj) {
+    events_.erase(std::remove_if(events_.begin(), events_.end(),
+        [obj](MapEvent& event) {return event.obj == obj;}), events_.end());
+    if (ObjectModifier* mod = obj->modifier()) {
+        remove_listener(mod);
+        forget_moved(mod);
     }
 }
 
+// Runs the callbacks of the queued Ts from index alerted on, and returns
+// whether there were any.
+// Index rather than iterate, in case a callback activates something else
+template <typename T>
+bool RoomMap::alert_listeners(unsigned int& alerted, DeltaFrame* delta_frame, MoveProcessor* mp) {
+    std::vector<ObjectModifier*>& queue = activated_listeners_[static_cast<int>(T::KIND)];
+    bool any = alerted < queue.size();
+    for (; alerted < queue.size(); ++alerted) {
+        static_cast<T*>(queue[alerted])->map_callback(this, delta_frame, mp);
+    }
+    return any;
+}
+
+// Callbacks run grouped by modifier type, in activation order within each type.
+// If a callback activates a listener whose type has had its turn, it gets another.
 void RoomMap::alert_activated_listeners(DeltaFrame* delta_frame, MoveProcessor* mp) {
-    for (ObjectModifier* obj : activated_listeners_) {
-        obj->map_callback(this, delta_frame, mp);
+    flush_events();
+    unsigned int doors = 0, switches = 0, gates = 0;
+    bool any = true;
+    while (any) {
+        any = alert_listeners<Door>(doors, delta_frame, mp);
+        any |= alert_listeners<PressSwitch>(switches, delta_frame, mp);
+        any |= alert_listeners<Gate>(gates, delta_frame, mp);
     }
 }
 
@@ -307,24 +654,30 @@ struct ObjectDrawer {
 
 void ObjectDrawer::operator()(int id) {
     if (id > GLOBAL_WALL_ID) {
-        obj_array[id]->draw(gfx);
+        GameObject* obj = obj_array[id];
+        obj->draw(gfx);
+        if (SnakeBlock* sb = kind_cast<SnakeBlock>(obj)) {
+            sb->draw_links(gfx, obj_array);
+        }
     }
 }
 
 void RoomMap::draw(GraphicsManager* gfx, float angle) {
-    GameObjIDFunc drawer = ObjectDrawer{obj_array_, gfx};
-    for (auto& layer : layers_) {
-        layer->apply_to_rect(MapRect{0,0,width_,height_}, drawer);
-    }
+    ObjectDrawer drawer {obj_array_, gfx};
+    for_each_in_rect(MapRect{0,0,width_,height_}, drawer);
     // TODO: draw walls!
     effects_->sort_by_distance(angle);
-    effects_->update();
+    update_effects();
     effects_->draw(gfx);
 }
 
+void RoomMap::update_effects() {
+    effects_->update();
+}
+
 void RoomMap::draw_layer(GraphicsManager* gfx, int z) {
-    GameObjIDFunc drawer = ObjectDrawer{obj_array_, gfx};
-    layers_[z].get()->apply_to_rect(MapRect{0,0,width_,height_}, drawer);
+    ObjectDrawer drawer {obj_array_, gfx};
+    for_each_in_layer(z, MapRect{0,0,width_,height_}, drawer);
 }
 
 struct ObjectShifter {
@@ -342,10 +695,14 @@ void ObjectShifter::operator()(int id) {
 }
 
 void RoomMap::shift_all_objects(Point3 d) {
-    GameObjIDFunc shifter = ObjectShifter{obj_array_, this, d};
-    for (auto& layer : layers_) {
-        layer->apply_to_rect(MapRect{0,0,width_,height_}, shifter);
-    }
+    ObjectShifter shifter {obj_array_, this, d};
+    for_each_in_rect(MapRect{0,0,width_,height_}, shifter);
+    // Gates are the only modifiers with positions of their own to fix up
+    for_each_modifier<Gate>([this, d](Gate* gate) {
+        if (gate->parent_->tangible_) {
+            gate->shift_internal_pos(this, d);
+        }
+    });
 }
 
 struct ObjectDestroyer {
@@ -362,151 +719,255 @@ void ObjectDestroyer::operator()(int id) {
 }
 
 void RoomMap::extend_by(Point3 d) {
-    GameObjIDFunc destroyer = ObjectDestroyer{obj_array_, this};
+    ObjectDestroyer destroyer {obj_array_, this};
     if (d.z < 0) {
-        for (int i = layers_.size() - 1; i >= layers_.size() + d.z; --i) {
-            layers_[i]->apply_to_rect(MapRect{0,0,width_,height_}, destroyer);
+        for (int i = depth_ + d.z; i < depth_; ++i) {
+            for_each_in_layer(i, MapRect{0,0,width_,height_}, destroyer);
         }
-        layers_.erase(layers_.begin(), layers_.begin() + d.z);
+        layers_.erase(layers_.end() + d.z, layers_.end());
     }
     if (d.y < 0) {
-        for (auto& layer : layers_) {
-            layer->apply_to_rect(MapRect{0, height_ + d.y, width_, height_}, destroyer);
-        }
+        for_each_in_rect(MapRect{0, height_ + d.y, width_, -d.y}, destroyer);
     }
     if (d.x < 0) {
-        for (auto& layer : layers_) {
-            layer->apply_to_rect(MapRect{width_ + d.x, 0, width_, height_}, destroyer);
-        }
+        for_each_in_rect(MapRect{width_ + d.x, 0, -d.x, height_}, destroyer);
     }
+    // Positions are about to change meaning
+    flush_events();
+    support_changes_.clear();
     width_ += d.x;
     height_ += d.y;
     depth_ += d.z;
     for (auto& layer : layers_) {
         layer->extend_by(d.x, d.y);
     }
+    walls_->extend_by(d);
+    columns_->extend_by(d);
+    rebuild_listener_flags();
+    dirty_->mark_everything();
     for (int i = 0; i < d.z; ++i) {
-        // Don't use push_full because we're tracking the depth manually!
-        layers_.insert(layers_.end(), std::make_unique<FullMapLayer>(this, width_, height_));
+        // depth_ has already been updated
+        layers_.insert(layers_.end(), make_layer(dense_layer_type()));
     }
 }
 
 void RoomMap::shift_by(Point3 d) {
-    GameObjIDFunc destroyer = ObjectDestroyer{obj_array_, this};
+    ObjectDestroyer destroyer {obj_array_, this};
     // First clean up objects if necessary, then actually shift the map
     if (d.z < 0) {
         for (int i = 0; i < -d.z; ++i) {
-            layers_[i]->apply_to_rect(MapRect{0,0,width_,height_}, destroyer);
+            for_each_in_layer(i, MapRect{0,0,width_,height_}, destroyer);
         }
         layers_.erase(layers_.begin(), layers_.begin() - d.z);
     }
     if (d.y < 0) {
-        for (auto& layer : layers_) {
-            layer->apply_to_rect(MapRect{0,0,width_,-d.y}, destroyer);
-        }
+        for_each_in_rect(MapRect{0,0,width_,-d.y}, destroyer);
     }
     if (d.x < 0) {
-        for (auto& layer : layers_) {
-            layer->apply_to_rect(MapRect{0,0,-d.x,height_}, destroyer);
-        }
+        for_each_in_rect(MapRect{0,0,-d.x,height_}, destroyer);
     }
+    // Positions are about to change meaning
+    flush_events();
+    support_changes_.clear();
     width_ += d.x;
     height_ += d.y;
     depth_ += d.z;
     for (auto& layer : layers_) {
         layer->shift_by(d.x, d.y);
     }
+    walls_->shift_by(d);
+    columns_->shift_by(d);
+    // Modifiers shift along with their objects, so their listeners must too
+    std::unordered_map<Point3, std::vector<ObjectModifier*>, Point3Hash> shifted_listeners {};
+    for (auto& p : listeners_) {
+        for (ObjectModifier* obj : p.second) {
+            obj->listen_pos_ += d;
+        }
+        shifted_listeners[p.first + d] = std::move(p.second);
+    }
+    listeners_ = std::move(shifted_listeners);
+    rebuild_listener_flags();
     for (int i = 0; i < d.z; ++i) {
-        layers_.insert(layers_.begin(), std::make_unique<FullMapLayer>(this, width_, height_));
+        layers_.insert(layers_.begin(), make_layer(dense_layer_type()));
     }
     shift_all_objects(d);
+    // Every position has changed meaning
+    dirty_->mark_everything();
 }
 
-struct RoomStateInitializer {
-    void operator()(int id);
-
-    GameObjectArray& obj_array;
-    MoveProcessor& mp;
-    RoomMap* room_map;
-    DeltaFrame* delta_frame;
-};
-
-void RoomStateInitializer::operator()(int id) {
-    GameObject* obj = obj_array[id];
-    if (obj->gravitable_) {
-        mp.add_to_fall_check(obj);
-    }
-    if (SnakeBlock* sb = dynamic_cast<SnakeBlock*>(obj)) {
-        sb->check_add_local_links(room_map, delta_frame);
-    }
-    if (ObjectModifier* mod = obj->modifier()) {
-        room_map->activate_listener_of(mod);
-    }
-}
-
+// Objects which aren't in the map (abstract or taken) are skipped
 void RoomMap::set_initial_state(bool editor_mode) {
     // Using a "fake" DeltaFrame just this once means we
     // don't have to do a bunch of redundant checks during play
     DeltaFrame dummy_df {};
-    MoveProcessor mp = MoveProcessor(nullptr, this, &dummy_df, false);
-    GameObjIDFunc state_initializer = RoomStateInitializer{obj_array_, mp, this, &dummy_df};
-    for (auto& layer : layers_) {
-        layer->apply_to_rect(MapRect{0,0,width_,height_}, state_initializer);
-    }
+    MoveProcessor mp {nullptr, this, &dummy_df, false};
+    sticky_cache_->reset();
+    gravitables_.for_each([&mp](GameObject* obj) {
+        if (obj->tangible_) {
+            mp.add_to_fall_check(obj);
+        }
+    });
+    snakes_.for_each([this, &dummy_df](SnakeBlock* sb) {
+        if (sb->tangible_) {
+            sb->check_add_local_links(this, &dummy_df);
+        }
+    });
+    // Only these kinds have map callbacks
+    auto activate = [this](ObjectModifier* mod) {
+        if (mod->parent_->tangible_) {
+            activate_listener_of(mod);
+        }
+    };
+    for_each_modifier<Door>(activate);
+    for_each_modifier<PressSwitch>(activate);
+    for_each_modifier<Gate>(activate);
+    update_layer_types();
     // In editor mode, don't check switches or gravity.
     if (editor_mode) {
+        forget_support_changes();
+        records_support_ = false;
         return;
     }
     mp.perform_switch_checks(true);
     mp.try_fall_step();
 }
 
-struct SnakeInitializer {
-    void operator()(int id);
-
-    GameObjectArray& obj_array;
-    RoomMap* room_map;
-    DeltaFrame* delta_frame;
-};
-
-void SnakeInitializer::operator()(int id) {
-    if (SnakeBlock* sb = dynamic_cast<SnakeBlock*>(obj_array[id])) {
-        sb->check_add_local_links(room_map, delta_frame);
-    }
-}
-
 // This function does just one of the things that set_initial_state does
 // But it's useful for making the SnakeTab convenient!
 void RoomMap::initialize_automatic_snake_links() {
     DeltaFrame dummy_df {};
-    GameObjIDFunc snake_initializer = SnakeInitializer{obj_array_, this, &dummy_df};
-    for (auto& layer : layers_) {
-        layer->apply_to_rect(MapRect{0,0,width_,height_}, snake_initializer);
-    }
+    snakes_.for_each([this, &dummy_df](SnakeBlock* sb) {
+        if (sb->tangible_) {
+            sb->check_add_local_links(this, &dummy_df);
+        }
+    });
 }
 
 // The room keeps track of some things which must be forgotten after a move or undo
 void RoomMap::reset_local_state() {
-    activated_listeners_ = {};
+    reset_listener_state();
+    support_changes_.clear();
+}
+
+// A move's support changes have to outlast its switch checks, until its fall step
+void RoomMap::reset_listener_state() {
+    flush_events();
+    for (auto& queue : activated_listeners_) {
+        queue.clear();
+    }
+    listener_gen_ = ++next_listener_gen_;
+    update_layer_types();
 }
 
+// A new signaler's count hasn't been checked against its state yet
 void RoomMap::push_signaler(std::unique_ptr<Signaler> signaler) {
+    signaler->map_ = this;
+    signaler->index_ = signalers_.size();
+    mark_signaler_dirty(signaler.get());
     signalers_.push_back(std::move(signaler));
 }
 
+int RoomMap::signaler_index(Signaler* signaler) {
+    return signaler->index_;
+}
+
+Signaler* RoomMap::signaler(int index) {
+    return signalers_[index].get();
+}
+
+void RoomMap::mark_signaler_dirty(Signaler* signaler) {
+    if (!signaler->dirty_) {
+        signaler->dirty_ = true;
+        dirty_signalers_.push_back(signaler);
+    }
+}
+
 // NOTE: this function breaks the "locality" rule, but it's probably not a big deal.
+// Sending a signal may toggle switches further down the line, so
+// dirty_signalers_ is a worklist which can grow while we go through it.
 void RoomMap::check_signalers(DeltaFrame* delta_frame, MoveProcessor* mp) {
-    for (auto& signaler : signalers_) {
+    for (unsigned int i = 0; i < dirty_signalers_.size(); ++i) {
+        Signaler* signaler = dirty_signalers_[i];
+        signaler->dirty_ = false;
         signaler->check_send_signal(this, delta_frame, mp);
     }
+    dirty_signalers_.clear();
 }
 
 void RoomMap::remove_signaler(Signaler* rem) {
-    signalers_.erase(std::remove_if(signalers_.begin(), signalers_.end(),
-        [rem](std::unique_ptr<Signaler>& sig) {return sig.get() == rem;}), signalers_.end());
+    dirty_signalers_.erase(std::remove(dirty_signalers_.begin(), dirty_signalers_.end(), rem), dirty_signalers_.end());
+    signalers_.erase(signalers_.begin() + rem->index_);
+    for (int i = 0; i < (int)signalers_.size(); ++i) {
+        signalers_[i]->index_ = i;
+    }
 }
 
 
 void RoomMap::make_fall_trail(GameObject* block, int height, int drop) {
     effects_->push_trail(block, height, drop);
 }
+
+DirtyTracker* RoomMap::dirty_tracker() {
+    return dirty_.get();
+}
+
+const std::vector<GameObject*>& RoomMap::sticky_group(GameObject* obj, Sticky sticky_level) {
+    return sticky_cache_->group(obj, sticky_level);
+}
+
+void RoomMap::update_color(GameObject* obj) {
+    dirty_->mark(obj->pos_);
+    sticky_cache_->invalidate(obj);
+    record_support_change({obj->pos_, obj->id_, true});
+}
+
+// Only the thing in a cell, the one above it, and (if the cell's old
+// contents were sticky) blocks stuck beside or below it can depend on
+// what's in the cell for support
+void RoomMap::collect_fall_check(std::vector<GameObject*>& fall_check) {
+    GameObjectArray& objs = obj_array_;
+    // Most neighbors are empty, which the column index can say without a layer lookup
+    auto check = [this, &objs, &fall_check](Point3 pos, bool only_sticky) {
+        if (!valid(pos) || !columns_->at(pos)) {
+            return;
+        }
+        int id = id_at(pos);
+        if (id <= GLOBAL_WALL_ID) {
+            return;
+        }
+        GameObject* obj = objs[id];
+        if (obj->gravitable_ && !(only_sticky && obj->sticky() == Sticky::None)) {
+            fall_check.push_back(obj);
+        }
+    };
+    for (SupportChange& change : support_changes_) {
+        // The id can be stale (if its object left again, or was freed by undo)
+        if (change.entered_id) {
+            GameObject* obj = objs[change.entered_id];
+            if (obj && obj->tangible_ && obj->pos_ == change.pos && obj->gravitable_) {
+                fall_check.push_back(obj);
+            }
+        }
+        if (!change.entered_id || change.sticky) {
+            check(change.pos + Point3{0,0,1}, false);
+        }
+        if (change.sticky) {
+            for (Point3 d : DIRECTIONS) {
+                if (d.z != 1) {
+                    check(change.pos + d, true);
+                }
+            }
+        }
+    }
+    support_changes_.clear();
+}
+
+void RoomMap::forget_support_changes() {
+    support_changes_.clear();
+}
+
+void RoomMap::record_support_change(SupportChange change) {
+    if (records_support_) {
+        support_changes_.push_back(change);
+    }
+}
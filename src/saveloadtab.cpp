@@ -1,9 +1,8 @@
 #include "saveloadtab.h"
 
+#include <algorithm>
 #include <iostream>
 
-#include "common_constants.h"
-
 #include "room.h"
 #include "roommap.h"
 #include "gameobject.h"
@@ -37,9 +36,9 @@ void SaveLoadTab::main_loop(EditorRoom* eroom) {
     ImGui::InputInt("Room Height##SAVELOAD", &height);
     ImGui::InputInt("Room Depth##SAVELOAD", &depth);
 
-    clamp(&width, 1, MAX_ROOM_DIMS);
-    clamp(&height, 1, MAX_ROOM_DIMS);
-    clamp(&depth, 1, MAX_ROOM_DIMS);
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    depth = std::max(depth, 1);
 
     if (ImGui::Button("Create New Map##SAVELOAD")) {
         editor_->new_room(map_name_input, width, height, depth);
@@ -85,9 +84,9 @@ void SaveLoadTab::main_loop(EditorRoom* eroom) {
     ImGui::InputInt("Extend Height##SAVELOAD", &extend_height);
     ImGui::InputInt("Extend Depth##SAVELOAD", &extend_depth);
 
-    clamp(&extend_width, 1 - cur_room_dims.x, MAX_ROOM_DIMS - cur_room_dims.x);
-    clamp(&extend_height, 1 - cur_room_dims.y, MAX_ROOM_DIMS - cur_room_dims.y);
-    clamp(&extend_depth, 1 - cur_room_dims.z, MAX_ROOM_DIMS - cur_room_dims.z);
+    extend_width = std::max(extend_width, 1 - cur_room_dims.x);
+    extend_height = std::max(extend_height, 1 - cur_room_dims.y);
+    extend_depth = std::max(extend_depth, 1 - cur_room_dims.z);
 
     if (ImGui::Button("Extend room?##SAVELOAD")) {
         Point3 dpos = {extend_width, extend_height, extend_depth};
@@ -109,9 +108,9 @@ void SaveLoadTab::main_loop(EditorRoom* eroom) {
     ImGui::InputInt("Shift Height##SAVELOAD", &shift_height);
     ImGui::InputInt("Shift Depth##SAVELOAD", &shift_depth);
 
-    clamp(&shift_width, 1 - cur_room_dims.x, MAX_ROOM_DIMS - cur_room_dims.x);
-    clamp(&shift_height, 1 - cur_room_dims.y, MAX_ROOM_DIMS - cur_room_dims.y);
-    clamp(&shift_depth, 1 - cur_room_dims.z, MAX_ROOM_DIMS - cur_room_dims.z);
+    shift_width = std::max(shift_width, 1 - cur_room_dims.x);
+    shift_height = std::max(shift_height, 1 - cur_room_dims.y);
+    shift_depth = std::max(shift_depth, 1 - cur_room_dims.z);
 
     if (ImGui::Button("Shift room?##SAVELOAD")) {
         Point3 dpos = {shift_width, shift_height, shift_depth};
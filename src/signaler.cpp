@@ -6,30 +6,34 @@
 #include "switchable.h"
 #include "delta.h"
 #include "mapfile.h"
+#include "roommap.h"
+#include "gameobject.h"
 
 Signaler::Signaler(const std::string& label, int count, int threshold, bool persistent, bool active):
 switches_ {}, switchables_ {},
 label_ {label},
 count_ {count}, threshold_ {threshold},
-active_ {active}, persistent_ {persistent} {}
+active_ {active}, persistent_ {persistent},
+map_ {}, index_ {}, dirty_ {false} {}
 
 Signaler::~Signaler() {}
 
+// A modifier's parent must have an id before it's pushed here
 void Signaler::push_switchable(Switchable* obj) {
-    switchables_.push_back(obj);
+    switchables_.push_back(obj->parent_->handle());
 }
 
 void Signaler::push_switch(Switch* obj) {
-    switches_.push_back(obj);
+    switches_.push_back(obj->parent_->handle());
 }
 
 void Signaler::push_switchable_mutual(Switchable* obj) {
-    switchables_.push_back(obj);
+    push_switchable(obj);
     obj->push_signaler(this);
 }
 
 void Signaler::push_switch_mutual(Switch* obj) {
-    switches_.push_back(obj);
+    push_switch(obj);
     obj->push_signaler(this);
 }
 
@@ -39,6 +43,9 @@ void Signaler::receive_signal(bool signal) {
     } else {
         --count_;
     }
+    if (map_) {
+        map_->mark_signaler_dirty(this);
+    }
 }
 
 void Signaler::toggle() {
@@ -47,9 +54,10 @@ void Signaler::toggle() {
 
 void Signaler::check_send_signal(RoomMap* room_map, DeltaFrame* delta_frame, MoveProcessor* mp) {
     if (!(active_ && persistent_) && ((count_ >= threshold_) != active_)) {
-        delta_frame->push(std::make_unique<SignalerToggleDelta>(this));
+        delta_frame->push(std::make_unique<SignalerToggleDelta>(this, room_map));
         active_ = !active_;
-        for (Switchable* obj : switchables_) {
+        for (GameObjectHandle h : switchables_) {
+            auto obj = static_cast<Switchable*>(room_map->obj_array_.get(h)->modifier());
             obj->receive_signal(active_, room_map, delta_frame, mp);
         }
     }
@@ -59,17 +67,18 @@ void Signaler::serialize(MapFileO& file) {
     file << MapCode::Signaler;
     file << label_;
     file << count_ << threshold_ << persistent_ << active_;
-    file << switches_.size();
-    file << switchables_.size();
-    for (auto& obj : switches_) {
-        file << obj->pos();
+    file << static_cast<unsigned int>(switches_.size());
+    file << static_cast<unsigned int>(switchables_.size());
+    for (GameObjectHandle h : switches_) {
+        file << map_->obj_array_.get(h)->pos_;
     }
-    for (auto& obj : switchables_) {
-        file << obj->pos();
+    for (GameObjectHandle h : switchables_) {
+        file << map_->obj_array_.get(h)->pos_;
     }
 }
 
 void Signaler::remove_object(ObjectModifier* obj) {
-    switchables_.erase(std::remove(switchables_.begin(), switchables_.end(), dynamic_cast<Switchable*>(obj)), switchables_.end());
-    switches_.erase(std::remove(switches_.begin(), switches_.end(), dynamic_cast<Switch*>(obj)), switches_.end());
+    GameObjectHandle h = obj->parent_->handle();
+    switchables_.erase(std::remove(switchables_.begin(), switchables_.end(), h), switchables_.end());
+    switches_.erase(std::remove(switches_.begin(), switches_.end(), h), switches_.end());
 }
@@ -0,0 +1,38 @@
+#include "slab.h"
+
+#include <algorithm>
+
+#include "common_constants.h"
+
+// Round up so that every block is suitably aligned for anything
+Slab::Slab(std::size_t size):
+size_ {(std::max(size, sizeof(void*)) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t)},
+next_chunk_count_ {SLAB_FIRST_CHUNK}, chunks_ {}, free_list_ {} {}
+
+Slab::~Slab() {}
+
+void* Slab::alloc() {
+    if (!free_list_) {
+        add_chunk();
+    }
+    void* block = free_list_;
+    free_list_ = *static_cast<void**>(block);
+    return block;
+}
+
+void Slab::free(void* block) {
+    *static_cast<void**>(block) = free_list_;
+    free_list_ = block;
+}
+
+// Thread the new blocks onto the free list in address order,
+// so that consecutive allocations are adjacent
+void Slab::add_chunk() {
+    unsigned int count = next_chunk_count_;
+    next_chunk_count_ = std::min(2*next_chunk_count_, SLAB_MAX_CHUNK);
+    chunks_.push_back(std::unique_ptr<char[]>(new char[size_*count]));
+    char* chunk = chunks_.back().get();
+    for (unsigned int i = count; i-- > 0;) {
+        free(chunk + i*size_);
+    }
+}
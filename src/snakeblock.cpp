@@ -1,4 +1,6 @@
 #include "snakeblock.h"
+
+#include "slab.h"
 #include "graphicsmanager.h"
 #include "mapfile.h"
 #include "component.h"
@@ -20,12 +22,24 @@ SnakeBlock* snake_cast(GameObject* obj) {
     }
 }
 
+static SnakeBlock* linked(GameObjectArray& objs, GameObjectHandle link) {
+    return static_cast<SnakeBlock*>(objs.get(link));
+}
+
 
 SnakeBlock::SnakeBlock(Point3 pos, int color, bool pushable, bool gravitable, int ends):
-GameObject(pos, color, pushable, gravitable), links_ {}, target_ {}, ends_ {ends}, distance_ {0}, dragged_ {false}  {}
+GameObject(ObjCode::SnakeBlock, pos, color, pushable, gravitable), links_ {}, target_ {}, ends_ {ends}, distance_ {0}, dragged_ {false}, snake_slot_ {-1} {}
 
 SnakeBlock::~SnakeBlock() {}
 
+void* SnakeBlock::operator new(std::size_t size) {
+    return slab_new<SnakeBlock>(size);
+}
+
+void SnakeBlock::operator delete(void* block, std::size_t size) {
+    slab_delete<SnakeBlock>(block, size);
+}
+
 std::string SnakeBlock::name() {
     return "SnakeBlock";
 }
@@ -49,10 +63,10 @@ bool SnakeBlock::relation_check() {
     return true;
 }
 
-void SnakeBlock::relation_serialize(MapFileO& file) {
+void SnakeBlock::relation_serialize(MapFileO& file, GameObjectArray& objs) {
     int link_encode = 0;
-    for (auto& link : links_) {
-        Point3 q = link->pos_;
+    for (GameObjectHandle link : links_) {
+        Point3 q = linked(objs, link)->pos_;
         // Snake links are always adjacent, and we only bother to
         // record links to the Right or Down
         if (q.x > pos_.x) {
@@ -74,7 +88,9 @@ void SnakeBlock::collect_sticky_links(RoomMap* room_map, Sticky sticky_level, st
         return;
     }
     // Insert this Snake's links into the collection of links
-    links.insert(links.end(), links_.begin(), links_.end());
+    for (GameObjectHandle link : links_) {
+        links.push_back(linked(room_map->obj_array_, link));
+    }
 }
 
 Sticky SnakeBlock::sticky() {
@@ -92,8 +108,8 @@ void SnakeBlock::collect_dragged_snake_links(RoomMap* room_map, Point3 dir, std:
     // NOTE: this does no harm even if obj is a link
     if (GameObject* obj = room_map->view(pos_ - dir)) {
         if (obj->comp_) {
-            for (SnakeBlock* link : links_) {
-                link->conditional_drag(weak_links);
+            for (GameObjectHandle link : links_) {
+                linked(room_map->obj_array_, link)->conditional_drag(weak_links);
             }
             return;
         }
@@ -103,10 +119,10 @@ void SnakeBlock::collect_dragged_snake_links(RoomMap* room_map, Point3 dir, std:
         return;
     }
     for (int i = 0; i < 2; ++i) {
-        Point3 link_pos {links_[i]->pos_};
+        Point3 link_pos {linked(room_map->obj_array_, links_[i])->pos_};
         // If there's a link behind us, drag the other
         if (link_pos + dir == pos_) {
-            links_[1 - i]->conditional_drag(weak_links);
+            linked(room_map->obj_array_, links_[1 - i])->conditional_drag(weak_links);
             return;
         }
         // If there's a link in front of us, don't drag anything
@@ -115,8 +131,8 @@ void SnakeBlock::collect_dragged_snake_links(RoomMap* room_map, Point3 dir, std:
         }
     }
     // At this point, we have 2 links, both of which are to the side
-    for (SnakeBlock* link : links_) {
-        link->conditional_drag(weak_links);
+    for (GameObjectHandle link : links_) {
+        linked(room_map->obj_array_, link)->conditional_drag(weak_links);
     }
 }
 
@@ -148,33 +164,39 @@ void SnakeBlock::draw(GraphicsManager* gfx) {
     } else {
         tex = Texture::LightEdges;
     }
-    if (dynamic_cast<AutoBlock*>(modifier())) {
+    if (kind_cast<AutoBlock>(modifier())) {
         tex = tex | Texture::AutoBlock;
-    } else if (dynamic_cast<Car*>(modifier())) {
+    } else if (kind_cast<Car>(modifier())) {
         tex = tex | Texture::Car;
     }
     gfx->set_tex(tex);
     gfx->draw_cube();
     draw_force_indicators(gfx, model);
     gfx->set_tex(Texture::Blank);
-    for (auto link : links_) {
-        FPoint3 q = link->real_pos();
+    if (modifier_) {
+        modifier()->draw(gfx, p);
+    }
+}
+
+// Drawn separately from the block itself, since the links have to be resolved
+void SnakeBlock::draw_links(GraphicsManager* gfx, GameObjectArray& objs) {
+    FPoint3 p {real_pos()};
+    gfx->set_tex(Texture::Blank);
+    for (GameObjectHandle link : links_) {
+        FPoint3 q = linked(objs, link)->real_pos();
         FPoint3 d {q.x - p.x, q.y - p.y, 0};
         gfx->set_color(COLORS[BLACK]);
-        model = glm::translate(glm::mat4(), glm::vec3(0.2f*d.x, 0.5f, 0.2f*d.y));
+        glm::mat4 model = glm::translate(glm::mat4(), glm::vec3(0.2f*d.x, 0.5f, 0.2f*d.y));
         model = glm::translate(model, glm::vec3(p.x, p.z, p.y));
         model = glm::scale(model, glm::vec3(0.1f + 0.2f*abs(d.x), 0.2f, 0.1f + 0.2f*abs(d.y)));
         gfx->set_model(model);
         gfx->draw_cube();
     }
-    if (modifier_) {
-        modifier()->draw(gfx, p);
-    }
 }
 
 
 bool SnakeBlock::in_links(SnakeBlock* sb) {
-    return std::find(links_.begin(), links_.end(), sb) != links_.end();
+    return std::find(links_.begin(), links_.end(), sb->handle()) != links_.end();
 }
 
 void SnakeBlock::add_link(SnakeBlock* sb, DeltaFrame* delta_frame) {
@@ -183,12 +205,12 @@ void SnakeBlock::add_link(SnakeBlock* sb, DeltaFrame* delta_frame) {
 }
 
 void SnakeBlock::add_link_quiet(SnakeBlock* sb) {
-    links_.push_back(sb);
-    sb->links_.push_back(this);
+    links_.push_back(sb->handle());
+    sb->links_.push_back(handle());
 }
 
 void SnakeBlock::add_link_one_way(SnakeBlock* sb) {
-    links_.push_back(sb);
+    links_.push_back(sb->handle());
 }
 
 void SnakeBlock::remove_link(SnakeBlock* sb, DeltaFrame* delta_frame) {
@@ -197,12 +219,12 @@ void SnakeBlock::remove_link(SnakeBlock* sb, DeltaFrame* delta_frame) {
 }
 
 void SnakeBlock::remove_link_quiet(SnakeBlock* sb) {
-    links_.erase(std::find(links_.begin(), links_.end(), sb));
-    sb->links_.erase(std::find(sb->links_.begin(), sb->links_.end(), this));
+    links_.erase(std::find(links_.begin(), links_.end(), sb->handle()));
+    sb->links_.erase(std::find(sb->links_.begin(), sb->links_.end(), handle()));
 }
 
 void SnakeBlock::remove_link_one_way(SnakeBlock* sb) {
-    links_.erase(std::find(links_.begin(), links_.end(), sb));
+    links_.erase(std::find(links_.begin(), links_.end(), sb->handle()));
 }
 
 bool SnakeBlock::can_link(SnakeBlock* snake) {
@@ -217,28 +239,30 @@ void SnakeBlock::check_add_local_links(RoomMap* room_map, DeltaFrame* delta_fram
         return;
     }
     for (auto& d : H_DIRECTIONS) {
-        auto snake = dynamic_cast<SnakeBlock*>(room_map->view(shifted_pos(d)));
+        auto snake = kind_cast<SnakeBlock>(room_map->view(shifted_pos(d)));
         if (snake && color_ == snake->color_ && snake->available() && !in_links(snake) && !snake->confused(room_map)) {
             add_link(snake, delta_frame);
         }
     }
 }
 
-void SnakeBlock::collect_maybe_confused_neighbors(RoomMap* room_map, std::unordered_set<SnakeBlock*>& check) {
+void SnakeBlock::collect_maybe_confused_neighbors(RoomMap* room_map, std::vector<SnakeBlock*>& check) {
     if (available()) {
         for (Point3 d : H_DIRECTIONS) {
-            auto snake = dynamic_cast<SnakeBlock*>(room_map->view(shifted_pos(d)));
+            auto snake = kind_cast<SnakeBlock>(room_map->view(shifted_pos(d)));
             // TODO: Make sure these conditions are reasonable
             if (snake && (color_ == snake->color_) && snake->available()) {
-                check.insert(snake);
+                push_unique(check, snake);
             }
         }
     }
 }
 
-void SnakeBlock::break_unmoving_links(std::vector<GameObject*>& fall_check, DeltaFrame* delta_frame) {
-    auto links_copy = links_;
-    for (SnakeBlock* link : links_copy) {
+void SnakeBlock::break_unmoving_links(RoomMap* room_map, std::vector<GameObject*>& fall_check, DeltaFrame* delta_frame) {
+    ScratchVector<GameObjectHandle> links_copy {};
+    links_copy = links_;
+    for (GameObjectHandle h : links_copy) {
+        SnakeBlock* link = linked(room_map->obj_array_, h);
         if (PushComponent* comp = link->push_comp()) {
             if (comp->blocked_) {
                 remove_link(link, delta_frame);
@@ -249,8 +273,10 @@ void SnakeBlock::break_unmoving_links(std::vector<GameObject*>& fall_check, Delt
 }
 
 void SnakeBlock::update_links_color(RoomMap* room_map, DeltaFrame* delta_frame) {
-    auto links_copy = links_;
-    for (auto link : links_copy) {
+    ScratchVector<GameObjectHandle> links_copy {};
+    links_copy = links_;
+    for (GameObjectHandle h : links_copy) {
+        SnakeBlock* link = linked(room_map->obj_array_, h);
         if (color_ != link->color_) {
             remove_link(link, delta_frame);
         }
@@ -265,7 +291,7 @@ bool SnakeBlock::available() {
 bool SnakeBlock::confused(RoomMap* room_map) {
     unsigned int available_count = 0;
     for (auto& d : H_DIRECTIONS) {
-        auto snake = dynamic_cast<SnakeBlock*>(room_map->view(shifted_pos(d)));
+        auto snake = kind_cast<SnakeBlock>(room_map->view(shifted_pos(d)));
         if (snake && color_ == snake->color_ && (snake->available() || in_links(snake))) {
             ++available_count;
         }
@@ -275,8 +301,8 @@ bool SnakeBlock::confused(RoomMap* room_map) {
 
 void SnakeBlock::cleanup_on_destruction(RoomMap* room_map) {
     reset_internal_state();
-    for (SnakeBlock* link : links_) {
-        link->remove_link_one_way(this);
+    for (GameObjectHandle link : links_) {
+        linked(room_map->obj_array_, link)->remove_link_one_way(this);
     }
     if (modifier_) {
         modifier_->cleanup_on_destruction(room_map);
@@ -284,26 +310,29 @@ void SnakeBlock::cleanup_on_destruction(RoomMap* room_map) {
 }
 
 void SnakeBlock::setup_on_undestruction(RoomMap* room_map) {
-    for (SnakeBlock* link : links_) {
-        link->add_link_one_way(this);
+    for (GameObjectHandle link : links_) {
+        linked(room_map->obj_array_, link)->add_link_one_way(this);
     }
     if (modifier_) {
         modifier_->setup_on_undestruction(room_map);
     }
 }
 
-std::unique_ptr<SnakeBlock> SnakeBlock::make_split_copy(RoomMap* room_map, DeltaFrame* delta_frame) {
-    auto split = std::make_unique<SnakeBlock>(pos_, color_, pushable_, gravitable_, 1);
+// The copy is created before its modifier, which may need its handle
+SnakeBlock* SnakeBlock::make_split_copy(RoomMap* room_map, DeltaFrame* delta_frame) {
+    auto split_unique = std::make_unique<SnakeBlock>(pos_, color_, pushable_, gravitable_, 1);
+    SnakeBlock* split = split_unique.get();
+    room_map->create(std::move(split_unique), delta_frame);
     if (modifier_) {
-        split->set_modifier(modifier_->duplicate(split.get(), room_map, delta_frame));
+        room_map->set_modifier(split, modifier_->duplicate(split, room_map, delta_frame));
     }
-    return std::move(split);
+    return split;
 }
 
 
 SnakePuller::SnakePuller(RoomMap* room_map, DeltaFrame* delta_frame,
                          std::vector<GameObject*>& moving_blocks,
-                         std::unordered_set<SnakeBlock*>& link_add_check,
+                         std::vector<SnakeBlock*>& link_add_check,
                          std::vector<GameObject*>& fall_check):
 map_ {room_map}, delta_frame_ {delta_frame}, snakes_to_pull_ {},
 moving_blocks_ {moving_blocks}, link_add_check_ {link_add_check}, fall_check_ {fall_check} {}
@@ -313,7 +342,8 @@ SnakePuller::~SnakePuller() {}
 void SnakePuller::prepare_pull(SnakeBlock* cur) {
     SnakeBlock* prev {};
     // A moving snake can have at most one link which isn't moving already
-    for (SnakeBlock* link : cur->links_) {
+    for (GameObjectHandle h : cur->links_) {
+        SnakeBlock* link = linked(map_->obj_array_, h);
         if (!link->moving_push_comp()) {
             prev = cur;
             cur = link;
@@ -335,7 +365,7 @@ void SnakePuller::prepare_pull(SnakeBlock* cur) {
                 // TODO: Make sure this is *really* the condition we want
                 // For now, a snake which is linked to anything else
                 //(at level Sticky::AllStick) will not be split.
-                std::vector<GameObject*> sticky_comp {};
+                ScratchVector<GameObject*> sticky_comp {};
                 cur->collect_special_links(map_, Sticky::AllStick, sticky_comp);
                 cur->reset_internal_state();
                 if (ObjectModifier* mod = cur->modifier()) {
@@ -343,31 +373,33 @@ void SnakePuller::prepare_pull(SnakeBlock* cur) {
                 }
                 // The split succeeded
                 if (sticky_comp.empty()) {
-                    std::vector<SnakeBlock*> links = cur->links_;
+                    ScratchVector<GameObjectHandle> links {};
+                    links = cur->links_;
                     map_->destroy(cur, delta_frame_);
-                    for (SnakeBlock* link : links) {
-                        auto split_copy_unique = cur->make_split_copy(map_, delta_frame_);
-                        SnakeBlock* split_copy = split_copy_unique.get();
-                        map_->create(std::move(split_copy_unique), delta_frame_);
+                    for (GameObjectHandle h : links) {
+                        SnakeBlock* link = linked(map_->obj_array_, h);
+                        SnakeBlock* split_copy = cur->make_split_copy(map_, delta_frame_);
                         split_copy->add_link(link, delta_frame_);
                         split_copy->target_ = link;
                         snakes_to_pull_.push_back(split_copy);
                     }
                 // The middle block couldn't be split; split around instead
                 } else {
-                    std::vector<SnakeBlock*> links = cur->links_;
-                    link_add_check_.insert(cur);
-                    for (SnakeBlock* link : links) {
+                    ScratchVector<GameObjectHandle> links {};
+                    links = cur->links_;
+                    push_unique(link_add_check_, cur);
+                    for (GameObjectHandle h : links) {
+                        SnakeBlock* link = linked(map_->obj_array_, h);
                         cur->remove_link(link, delta_frame_);
-                        link_add_check_.insert(link);
+                        push_unique(link_add_check_, link);
                         snakes_to_pull_.push_back(link);
                     }
                 }
                 return;
             // The chain was even length; cut!
             } else if (cur->distance_ == prev->distance_) {
-                link_add_check_.insert(cur);
-                link_add_check_.insert(prev);
+                push_unique(link_add_check_, cur);
+                push_unique(link_add_check_, prev);
                 cur->remove_link(prev, delta_frame_);
                 snakes_to_pull_.push_back(cur);
                 snakes_to_pull_.push_back(prev);
@@ -377,13 +409,14 @@ void SnakePuller::prepare_pull(SnakeBlock* cur) {
         cur->target_ = prev;
         // If cur is the end of the snake, pull it
         if (cur->links_.size() == 1) {
-            link_add_check_.insert(cur);
+            push_unique(link_add_check_, cur);
             cur->collect_maybe_confused_neighbors(map_, link_add_check_);
             snakes_to_pull_.push_back(cur);
             return;
         }
         // Progress down the snake
-        for (SnakeBlock* link : cur->links_) {
+        for (GameObjectHandle h : cur->links_) {
+            SnakeBlock* link = linked(map_->obj_array_, h);
             if (link != prev) {
                 cur->distance_ = prev->distance_ + 1;
                 prev = cur;
@@ -0,0 +1,110 @@
+#include "stickycache.h"
+
+#include "common_constants.h"
+#include "gameobject.h"
+#include "gameobjectarray.h"
+#include "roommap.h"
+#include "movearena.h"
+
+StickyCache::StickyCache(RoomMap* room_map): map_ {room_map},
+strong_group_of_ {}, all_group_of_ {}, groups_ {}, free_groups_ {}, uncached_ {},
+visited_ {}, visit_stamp_ {0} {}
+
+StickyCache::~StickyCache() {}
+
+const std::vector<GameObject*>& StickyCache::group(GameObject* obj, Sticky sticky_level) {
+    std::vector<int>* group_of = nullptr;
+    if (sticky_level == Sticky::Strong) {
+        group_of = &strong_group_of_;
+    } else if (sticky_level == Sticky::All) {
+        group_of = &all_group_of_;
+    }
+    if (!group_of || obj->kind_ == ObjCode::SnakeBlock) {
+        uncached_.clear();
+        build(obj, sticky_level, uncached_);
+        return uncached_;
+    }
+    // A block that can't stick at this level is a group by itself
+    if ((obj->sticky() & sticky_level) == Sticky::None) {
+        uncached_.clear();
+        uncached_.push_back(obj);
+        return uncached_;
+    }
+    if (obj->id_ < (int)group_of->size() && (*group_of)[obj->id_] >= 0) {
+        return groups_[(*group_of)[obj->id_]];
+    }
+    int g;
+    if (free_groups_.empty()) {
+        g = groups_.size();
+        groups_.emplace_back();
+    } else {
+        g = free_groups_.back();
+        free_groups_.pop_back();
+    }
+    build(obj, sticky_level, groups_[g]);
+    for (GameObject* member : groups_[g]) {
+        if (member->id_ >= (int)group_of->size()) {
+            group_of->resize(map_->obj_array_.size(), -1);
+        }
+        (*group_of)[member->id_] = g;
+    }
+    return groups_[g];
+}
+
+// Visits blocks in the same order collect_sticky_component always has
+void StickyCache::build(GameObject* start, Sticky sticky_level, std::vector<GameObject*>& members) {
+    if (visited_.size() < map_->obj_array_.size()) {
+        visited_.resize(map_->obj_array_.size(), 0);
+    }
+    ++visit_stamp_;
+    ScratchVector<GameObject*> to_check {};
+    to_check.push_back(start);
+    while (!to_check.empty()) {
+        GameObject* cur = to_check.back();
+        to_check.pop_back();
+        if (visited_[cur->id_] == visit_stamp_) {
+            continue;
+        }
+        visited_[cur->id_] = visit_stamp_;
+        members.push_back(cur);
+        cur->collect_sticky_links(map_, sticky_level, to_check);
+    }
+}
+
+void StickyCache::invalidate(GameObject* obj) {
+    // Only blocks which stick to other blocks are ever part of a cached group
+    if ((obj->sticky() & Sticky::AllStick) == Sticky::None) {
+        return;
+    }
+    drop_group_of(obj->id_);
+    for (Point3 d : DIRECTIONS) {
+        int id = map_->id_at(obj->pos_ + d);
+        if (id > GLOBAL_WALL_ID) {
+            drop_group_of(id);
+        }
+    }
+}
+
+void StickyCache::drop_group_of(int id) {
+    for (std::vector<int>* group_of : {&strong_group_of_, &all_group_of_}) {
+        if (id >= (int)group_of->size()) {
+            continue;
+        }
+        int g = (*group_of)[id];
+        if (g < 0) {
+            continue;
+        }
+        for (GameObject* member : groups_[g]) {
+            (*group_of)[member->id_] = -1;
+        }
+        groups_[g].clear();
+        free_groups_.push_back(g);
+    }
+}
+
+void StickyCache::reset() {
+    strong_group_of_.clear();
+    all_group_of_.clear();
+    groups_.clear();
+    free_groups_.clear();
+}
@@ -6,7 +6,7 @@
 #include <algorithm>
 
 
-Switch::Switch(GameObject* parent, bool persistent, bool active): ObjectModifier(parent),
+Switch::Switch(GameObject* parent, ModCode kind, bool persistent, bool active): ObjectModifier(parent, kind),
 persistent_ {persistent}, active_ {active}, signalers_ {} {}
 
 Switch::~Switch() {}
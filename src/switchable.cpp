@@ -4,7 +4,7 @@
 #include "moveprocessor.h"
 #include "signaler.h"
 
-Switchable::Switchable(GameObject* parent, bool def, bool active, bool waiting): ObjectModifier(parent),
+Switchable::Switchable(GameObject* parent, ModCode kind, bool def, bool active, bool waiting): ObjectModifier(parent, kind),
 default_ {def},
 active_ {active},
 waiting_ {waiting},
@@ -20,8 +20,8 @@ static Signaler* selected_sig = nullptr;
 static bool* persistent = nullptr;
 static int* threshold = nullptr;
 
-static std::vector<Switch*>* switches = nullptr;
-static std::vector<Switchable*>* switchables = nullptr;
+static std::vector<GameObjectHandle>* switches = nullptr;
+static std::vector<GameObjectHandle>* switchables = nullptr;
 
 enum class Threshold {
     All,
@@ -88,16 +88,23 @@ void SwitchTab::main_loop(EditorRoom* eroom) {
         switchables = &model_switchables_;
     }
 
+    // Objects deleted since they were queued leave stale handles behind
+    GameObjectArray& objs = eroom->map()->obj_array_;
+    auto stale = [&objs](GameObjectHandle h) {return objs.get(h) == nullptr;};
+    switches->erase(std::remove_if(switches->begin(), switches->end(), stale), switches->end());
+    switchables->erase(std::remove_if(switchables->begin(), switchables->end(), stale), switchables->end());
+
     ImGui::Text("Switches");
     for (int i = 0; i < switches->size(); ++i) {
-        Switch* s = (*switches)[i];
-        Point3 pos = s->pos();
-        ImGui::Text("%s at (%d,%d,%d)", s->parent_->to_str().c_str(), pos.x, pos.y, pos.z);
+        GameObjectHandle h = (*switches)[i];
+        GameObject* s = objs.get(h);
+        Point3 pos = s->pos_;
+        ImGui::Text("%s at (%d,%d,%d)", s->to_str().c_str(), pos.x, pos.y, pos.z);
         ImGui::SameLine();
         char buf[32];
         sprintf(buf, "Erase##SWITCH_a_%d", i);
         if (ImGui::Button(buf)) {
-            switches->erase(std::remove(switches->begin(), switches->end(), s), switches->end());
+            switches->erase(std::remove(switches->begin(), switches->end(), h), switches->end());
         }
     }
 
@@ -105,14 +112,15 @@ void SwitchTab::main_loop(EditorRoom* eroom) {
 
     ImGui::Text("Switchables");
     for (int i = 0; i < switchables->size(); ++i) {
-        Switchable* s = (*switchables)[i];
-        Point3 pos = s->pos();
-        ImGui::Text("%s at (%d,%d,%d)", s->parent_->to_str().c_str(), pos.x, pos.y, pos.z);
+        GameObjectHandle h = (*switchables)[i];
+        GameObject* s = objs.get(h);
+        Point3 pos = s->pos_;
+        ImGui::Text("%s at (%d,%d,%d)", s->to_str().c_str(), pos.x, pos.y, pos.z);
         ImGui::SameLine();
         char buf[32];
         sprintf(buf, "Erase##SWITCH_b_%d", i);
         if (ImGui::Button(buf)) {
-            switchables->erase(std::remove(switchables->begin(), switchables->end(), s), switchables->end());
+            switchables->erase(std::remove(switchables->begin(), switchables->end(), h), switchables->end());
         }
     }
 
@@ -188,11 +196,11 @@ void SwitchTab::main_loop(EditorRoom* eroom) {
                 label = "UNNAMED";
             }
             auto signaler = std::make_unique<Signaler>(label, 0, *threshold, *persistent, false);
-            for (auto& obj : model_switches_) {
-                signaler->push_switch_mutual(obj);
+            for (GameObjectHandle h : model_switches_) {
+                signaler->push_switch_mutual(static_cast<Switch*>(objs.get(h)->modifier()));
             }
-            for (auto& obj : model_switchables_) {
-                signaler->push_switchable_mutual(obj);
+            for (GameObjectHandle h : model_switchables_) {
+                signaler->push_switchable_mutual(static_cast<Switchable*>(objs.get(h)->modifier()));
             }
             eroom->map()->push_signaler(std::move(signaler));
             model_switches_.clear();
@@ -207,14 +215,13 @@ void SwitchTab::handle_left_click(EditorRoom* eroom, Point3 pos) {
     }
     if (GameObject* obj = eroom->map()->view(pos)) {
         if (ObjectModifier* mod = obj->modifier()) {
-            auto swble = dynamic_cast<Switchable*>(mod);
-            if (swble && std::find(switchables->begin(), switchables->end(), swble) == switchables->end()) {
-                switchables->push_back(swble);
+            GameObjectHandle h = obj->handle();
+            if (dynamic_cast<Switchable*>(mod) && std::find(switchables->begin(), switchables->end(), h) == switchables->end()) {
+                switchables->push_back(h);
                 return;
             }
-            auto sw = dynamic_cast<Switch*>(mod);
-            if (sw && std::find(switches->begin(), switches->end(), sw) == switches->end())  {
-                switches->push_back(sw);
+            if (dynamic_cast<Switch*>(mod) && std::find(switches->begin(), switches->end(), h) == switches->end())  {
+                switches->push_back(h);
                 return;
             }
         }
@@ -226,8 +233,8 @@ void SwitchTab::handle_right_click(EditorRoom* eroom, Point3 pos) {
         return;
     }
     if (GameObject* obj = eroom->map()->view(pos)) {
-        ObjectModifier* mod = obj->modifier();
-        switches->erase(std::remove(switches->begin(), switches->end(), mod), switches->end());
-        switchables->erase(std::remove(switchables->begin(), switchables->end(), mod), switchables->end());
+        GameObjectHandle h = obj->handle();
+        switches->erase(std::remove(switches->begin(), switches->end(), h), switches->end());
+        switchables->erase(std::remove(switchables->begin(), switchables->end(), h), switchables->end());
     }
 }
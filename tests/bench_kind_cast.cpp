@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "testing.h"
+#include "gameobject.h"
+#include "objectmodifier.h"
+#include "pushblock.h"
+#include "snakeblock.h"
+#include "player.h"
+#include "gatebody.h"
+#include "car.h"
+#include "door.h"
+
+// Time kind_cast against the dynamic_cast it replaced, on the casts the
+// move code makes most: "is this object a SnakeBlock?" and "is this
+// modifier a Car?", over a shuffled mix of objects like a room's
+
+const int OBJECTS = 4096;
+const int PASSES = 2000;
+
+template <typename F>
+static double time_passes(const char* label, F count_hits) {
+    long hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PASSES; ++i) {
+        hits += count_hits();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / (double(PASSES) * OBJECTS);
+    std::printf("%-28s %6.2f ns per cast (%ld hits)\n", label, ns, hits);
+    return ns;
+}
+
+int main() {
+    std::srand(1);
+    std::vector<std::unique_ptr<GameObject>> owned {};
+    for (int i = 0; i < OBJECTS; ++i) {
+        Point3 pos {i, 0, 0};
+        switch (std::rand() % 5) {
+        case 0:
+            owned.push_back(std::make_unique<SnakeBlock>(pos, 0, true, true, 2));
+            break;
+        case 1:
+            owned.push_back(std::make_unique<Player>(pos, RidingState::Free));
+            break;
+        case 2:
+            owned.push_back(std::make_unique<GateBody>(pos, 0, true, true));
+            break;
+        default:
+            owned.push_back(std::make_unique<PushBlock>(pos, 0, true, true, Sticky::Weak));
+            break;
+        }
+        GameObject* obj = owned.back().get();
+        if (std::rand() % 4 == 0) {
+            obj->set_modifier(std::make_unique<Car>(obj, ColorCycle {0}));
+        } else if (std::rand() % 4 == 0) {
+            obj->set_modifier(std::make_unique<Door>(obj, true, true));
+        }
+    }
+    std::vector<GameObject*> objs {};
+    for (auto& obj : owned) {
+        objs.push_back(obj.get());
+    }
+
+    double dynamic_obj = time_passes("dynamic_cast<SnakeBlock*>", [&objs]() {
+        int n = 0;
+        for (GameObject* obj : objs) {
+            n += dynamic_cast<SnakeBlock*>(obj) != nullptr;
+        }
+        return n;
+    });
+    double kind_obj = time_passes("kind_cast<SnakeBlock>", [&objs]() {
+        int n = 0;
+        for (GameObject* obj : objs) {
+            n += kind_cast<SnakeBlock>(obj) != nullptr;
+        }
+        return n;
+    });
+    double dynamic_mod = time_passes("dynamic_cast<Car*>", [&objs]() {
+        int n = 0;
+        for (GameObject* obj : objs) {
+            n += dynamic_cast<Car*>(obj->modifier()) != nullptr;
+        }
+        return n;
+    });
+    double kind_mod = time_passes("kind_cast<Car>", [&objs]() {
+        int n = 0;
+        for (GameObject* obj : objs) {
+            n += kind_cast<Car>(obj->modifier()) != nullptr;
+        }
+        return n;
+    });
+    std::printf("speedup: objects %.1fx, modifiers %.1fx\n", dynamic_obj / kind_obj, dynamic_mod / kind_mod);
+
+    // The two kinds of cast have to agree
+    for (GameObject* obj : objs) {
+        CHECK(dynamic_cast<SnakeBlock*>(obj) == kind_cast<SnakeBlock>(obj));
+        CHECK(dynamic_cast<Car*>(obj->modifier()) == kind_cast<Car>(obj->modifier()));
+    }
+    return failed_checks != 0;
+}
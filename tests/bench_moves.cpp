@@ -0,0 +1,74 @@
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+
+#include "gameobjectarray.h"
+#include "room.h"
+#include "roommap.h"
+#include "delta.h"
+#include "moveprocessor.h"
+#include "pushblock.h"
+#include "snakeblock.h"
+#include "player.h"
+
+// Time a player wandering at random through a room crowded with blocks and
+// snakes of every kind of stickiness, pushing whatever is in the way.
+// This only uses interfaces that have been stable for a long time, so the
+// same file can time older revisions of the move code too.
+
+const int ROOM_SIZE = 48;
+const int ROOMS = 50;
+const int MOVES_PER_ROOM = 500;
+
+static double wander(unsigned int seed) {
+    std::srand(seed);
+    GameObjectArray objs {};
+    Room room {"wander"};
+    room.initialize(objs, ROOM_SIZE, ROOM_SIZE, 4);
+    RoomMap* map = room.map();
+    for (int y = 0; y < ROOM_SIZE; ++y) {
+        map->create_wall_run({0, y, 0}, ROOM_SIZE);
+    }
+    const Sticky stickies[4] = {Sticky::None, Sticky::Weak, Sticky::Strong, Sticky::AllStick};
+    int center = ROOM_SIZE / 2;
+    for (int i = 0; i < ROOM_SIZE * ROOM_SIZE; ++i) {
+        Point3 pos {std::rand() % ROOM_SIZE, std::rand() % ROOM_SIZE, 1 + std::rand() % 2};
+        if (map->view(pos) || (pos.x == center && pos.y == center)) {
+            continue;
+        }
+        int kind = std::rand() % 8;
+        if (kind == 0) {
+            map->create_wall(pos);
+        } else if (kind == 1) {
+            map->create(std::make_unique<SnakeBlock>(pos, std::rand() % 3, true, true, 1 + std::rand() % 2), nullptr);
+        } else {
+            map->create(std::make_unique<PushBlock>(pos, std::rand() % 3, true, true, stickies[std::rand() % 4]), nullptr);
+        }
+    }
+    auto player_unique = std::make_unique<Player>(Point3{center, center, 1}, RidingState::Free);
+    Player* player = player_unique.get();
+    map->create(std::move(player_unique), nullptr);
+    map->set_initial_state(false);
+
+    const Point3 dirs[4] = {{1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < MOVES_PER_ROOM; ++i) {
+        DeltaFrame delta_frame {};
+        MoveProcessor mp {nullptr, map, &delta_frame, true};
+        if (mp.try_move(player, dirs[std::rand() % 4])) {
+            while (!mp.update()) {}
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main() {
+    double ms = 0;
+    for (int i = 0; i < ROOMS; ++i) {
+        ms += wander(i + 1);
+    }
+    std::printf("%d moves in %.1f ms (%.1f us per move)\n", ROOMS * MOVES_PER_ROOM, ms,
+                1000 * ms / (ROOMS * MOVES_PER_ROOM));
+    return 0;
+}
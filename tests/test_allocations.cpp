@@ -0,0 +1,162 @@
+#include <cstdlib>
+#include <new>
+#include <memory>
+
+#include "testing.h"
+#include "gameobjectarray.h"
+#include "room.h"
+#include "roommap.h"
+#include "delta.h"
+#include "moveprocessor.h"
+#include "pushblock.h"
+#include "player.h"
+#include "snakeblock.h"
+
+// Every allocation in the program goes through here, so a test can count
+// the allocations made by a stretch of code
+static long allocations = 0;
+
+void* operator new(std::size_t n) {
+    ++allocations;
+    if (void* p = std::malloc(n ? n : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// Recording a move for undo takes its DeltaFrame and the common deltas
+// from slabs, and their lists from the scratch buffers; the undo stack is
+// a ring.  Everything else a move touches (components, scratch vectors, the
+// cells of the map) is reused from one move to the next too, so once a room
+// has been played in for a bit a move shouldn't allocate at all.
+const long ALLOCATIONS_PER_MOVE = 0;
+
+const int ROOM_SIZE = 40;
+const int TRAIN_LENGTH = 8;
+const int WARMUP_MOVES = 100;
+const int MEASURED_MOVES = 100;
+// Enough for the fall trails to fade out, as they would while the game
+// draws the frames of the next move
+const int FRAMES_BETWEEN_MOVES = 16;
+
+static void make_move(RoomMap* map, Player* player, Point3 dir, UndoStack& undo) {
+    auto delta_frame = std::make_unique<DeltaFrame>();
+    {
+        auto mp = std::make_unique<MoveProcessor>(nullptr, map, delta_frame.get(), true);
+        if (mp->try_move(player, dir)) {
+            while (!mp->update()) {}
+        }
+    }
+    undo.push(std::move(delta_frame));
+}
+
+// Make the same move and undo it, over and over, and count the allocations
+// made by the measured ones
+static long push_and_undo(RoomMap* map, Player* player, Point3 dir, UndoStack& undo) {
+    long before = 0;
+    for (int i = 0; i < WARMUP_MOVES + MEASURED_MOVES; ++i) {
+        if (i == WARMUP_MOVES) {
+            before = allocations;
+        }
+        make_move(map, player, dir, undo);
+        undo.pop();
+        map->reset_local_state();
+        for (int j = 0; j < FRAMES_BETWEEN_MOVES; ++j) {
+            map->update_effects();
+        }
+    }
+    return allocations - before;
+}
+
+int main() {
+    GameObjectArray objs {};
+    Room room {"allocations"};
+    room.initialize(objs, ROOM_SIZE, ROOM_SIZE, 4);
+    RoomMap* map = room.map();
+
+    // A row of blocks on the floor
+    int y = ROOM_SIZE / 2;
+    for (int dy = -1; dy <= 1; ++dy) {
+        map->create_wall_run({0, y + dy, 0}, ROOM_SIZE);
+    }
+    for (int i = 0; i < TRAIN_LENGTH; ++i) {
+        map->create(std::make_unique<PushBlock>(Point3{10 + i, y, 1}, 1, true, true, Sticky::None), nullptr);
+    }
+    auto player_unique = std::make_unique<Player>(Point3{9, y, 1}, RidingState::Free);
+    Player* player = player_unique.get();
+    map->create(std::move(player_unique), nullptr);
+
+    // A block at the edge of a ledge, which falls one step when pushed off
+    int ledge_y = 5;
+    map->create_wall_run({0, ledge_y, 0}, ROOM_SIZE);
+    map->create_wall_run({0, ledge_y, 1}, 10);
+    PushBlock* faller = nullptr;
+    {
+        auto block = std::make_unique<PushBlock>(Point3{9, ledge_y, 2}, 1, true, true, Sticky::None);
+        faller = block.get();
+        map->create(std::move(block), nullptr);
+    }
+
+    // A snake, which gets pulled along and relinked when pushed
+    int snake_y = 30;
+    map->create_wall_run({0, snake_y, 0}, ROOM_SIZE);
+    SnakeBlock* snake_tail = nullptr;
+    for (int i = 0; i < 3; ++i) {
+        auto block = std::make_unique<SnakeBlock>(Point3{10 + i, snake_y, 1}, 1, true, true, (i == 1) ? 2 : 1);
+        snake_tail = block.get();
+        map->create(std::move(block), nullptr);
+    }
+    map->initialize_automatic_snake_links();
+    map->set_initial_state(false);
+    UndoStack undo {objs, 20};
+
+    long pushes = push_and_undo(map, player, {1,0,0}, undo);
+    std::printf("allocations in %d pushes and undos: %ld\n", MEASURED_MOVES, pushes);
+    CHECK(pushes <= ALLOCATIONS_PER_MOVE * MEASURED_MOVES);
+    CHECK(player->pos_ == (Point3{9, y, 1}));
+
+    // Walk back and forth, with the undo stack full so old frames get dropped
+    long before = 0;
+    for (int i = 0; i < WARMUP_MOVES + MEASURED_MOVES; ++i) {
+        if (i == WARMUP_MOVES) {
+            before = allocations;
+        }
+        make_move(map, player, {(i % 2) ? 1 : -1, 0, 0}, undo);
+    }
+    long steps = allocations - before;
+    std::printf("allocations in %d steps: %ld\n", MEASURED_MOVES, steps);
+    CHECK(steps <= ALLOCATIONS_PER_MOVE * MEASURED_MOVES);
+    CHECK(player->pos_ == (Point3{9, y, 1}));
+
+    // Push the block off the ledge, so that it falls and lands, and undo it
+    map->just_shift(player, {-1, ledge_y - y, 1});
+    make_move(map, player, {1,0,0}, undo);
+    CHECK(faller->pos_ == (Point3{10, ledge_y, 1}));
+    undo.pop();
+    map->reset_local_state();
+    long falls = push_and_undo(map, player, {1,0,0}, undo);
+    std::printf("allocations in %d falls and undos: %ld\n", MEASURED_MOVES, falls);
+    CHECK(falls <= ALLOCATIONS_PER_MOVE * MEASURED_MOVES);
+    CHECK(faller->pos_ == (Point3{9, ledge_y, 2}));
+
+    // Push the end of the snake sideways, which pulls the rest after it
+    map->just_shift(player, {2, snake_y - 1 - ledge_y, -1});
+    make_move(map, player, {0,1,0}, undo);
+    CHECK(snake_tail->pos_ == (Point3{11, snake_y, 1}));
+    undo.pop();
+    map->reset_local_state();
+    long pulls = push_and_undo(map, player, {0,1,0}, undo);
+    std::printf("allocations in %d snake pushes and undos: %ld\n", MEASURED_MOVES, pulls);
+    CHECK(pulls <= ALLOCATIONS_PER_MOVE * MEASURED_MOVES);
+    CHECK(snake_tail->pos_ == (Point3{12, snake_y, 1}));
+
+    return failed_checks != 0;
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <pthread.h>
+
+#include "testing.h"
+#include "gameobjectarray.h"
+#include "room.h"
+#include "roommap.h"
+#include "delta.h"
+#include "moveprocessor.h"
+#include "pushblock.h"
+#include "player.h"
+
+const int PUSHES = 4;
+
+// A player at the back of a straight train of length blocks on a wall
+// pushes it PUSHES times; check that the whole train and the player moved
+static void push_train(int length, Sticky sticky) {
+    GameObjectArray objs {};
+    Room room {"train"};
+    room.initialize(objs, length + PUSHES + 4, 3, 3);
+    RoomMap* map = room.map();
+    map->create_wall_run({0, 1, 0}, length + PUSHES + 4);
+    std::vector<GameObject*> train {};
+    for (int i = 0; i < length; ++i) {
+        auto block = std::make_unique<PushBlock>(Point3{2 + i, 1, 1}, i % 2, true, true, sticky);
+        train.push_back(block.get());
+        map->create(std::move(block), nullptr);
+    }
+    auto player_unique = std::make_unique<Player>(Point3{1, 1, 1}, RidingState::Free);
+    Player* player = player_unique.get();
+    map->create(std::move(player_unique), nullptr);
+    map->set_initial_state(false);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PUSHES; ++i) {
+        DeltaFrame delta_frame {};
+        MoveProcessor mp {nullptr, map, &delta_frame, true};
+        CHECK(mp.try_move(player, {1,0,0}));
+        while (!mp.update()) {}
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::printf("pushed %d blocks %d times in %.2f ms\n", length, PUSHES,
+                std::chrono::duration<double, std::milli>(end - start).count());
+
+    CHECK(player->pos_ == (Point3{1 + PUSHES, 1, 1}));
+    bool all_moved = true;
+    for (int i = 0; i < length; ++i) {
+        all_moved = all_moved && train[i]->pos_ == (Point3{2 + i + PUSHES, 1, 1}) &&
+            map->view(train[i]->pos_) == train[i];
+    }
+    CHECK(all_moved);
+}
+
+// A train much longer than the stack could hold one frame per block of
+const int LONG_TRAIN = 16000;
+const std::size_t SMALL_STACK = 256 * 1024;
+
+static void* push_long_trains(void*) {
+    push_train(LONG_TRAIN, Sticky::None);
+    push_train(LONG_TRAIN, Sticky::Weak);
+    return nullptr;
+}
+
+int main() {
+    push_train(1000, Sticky::None);
+    push_train(1000, Sticky::Weak);
+    push_train(1000, Sticky::Strong);
+
+    // Pushing shouldn't need stack in proportion to the length of the train
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, SMALL_STACK);
+    pthread_t thread;
+    CHECK(pthread_create(&thread, &attr, push_long_trains, nullptr) == 0);
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attr);
+
+    return failed_checks != 0;
+}
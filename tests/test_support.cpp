@@ -0,0 +1,107 @@
+#include <memory>
+
+#include "testing.h"
+#include "gameobjectarray.h"
+#include "room.h"
+#include "roommap.h"
+#include "delta.h"
+#include "moveprocessor.h"
+#include "pushblock.h"
+#include "player.h"
+
+const int ROOM_SIZE = 6;
+
+static void make_room(Room& room, GameObjectArray& objs) {
+    room.initialize(objs, ROOM_SIZE, ROOM_SIZE, 4);
+    for (int y = 0; y < ROOM_SIZE; ++y) {
+        room.map()->create_wall_run({0, y, 0}, ROOM_SIZE);
+    }
+}
+
+static void make_move(RoomMap* map, Player* player, Point3 dir, UndoStack& undo) {
+    auto delta_frame = std::make_unique<DeltaFrame>();
+    {
+        MoveProcessor mp {nullptr, map, delta_frame.get(), true};
+        if (mp.try_move(player, dir)) {
+            while (!mp.update()) {}
+        }
+    }
+    undo.push(std::move(delta_frame));
+}
+
+// A block resting on the player, in a room of its own
+struct Stack {
+    Room room;
+    Player* player;
+    PushBlock* block;
+
+    Stack(GameObjectArray& objs): room {"stack"}, player {}, block {} {
+        make_room(room, objs);
+        auto player_unique = std::make_unique<Player>(Point3{2, 2, 1}, RidingState::Free);
+        player = player_unique.get();
+        room.map()->create(std::move(player_unique), nullptr);
+        auto block_unique = std::make_unique<PushBlock>(Point3{2, 2, 2}, 1, true, true, Sticky::None);
+        block = block_unique.get();
+        room.map()->create(std::move(block_unique), nullptr);
+        room.map()->set_initial_state(false);
+    }
+};
+
+// The player walks out from under the block, after undoing a move of
+// their own, and the block falls
+static void walk_away_after_undo() {
+    GameObjectArray objs {};
+    UndoStack undo {objs, 20};
+    Stack stack {objs};
+    RoomMap* map = stack.room.map();
+    CHECK(stack.block->pos_ == (Point3{2, 2, 2}));
+
+    make_move(map, stack.player, {0,1,0}, undo);
+    CHECK(stack.block->pos_ == (Point3{2, 2, 1}));
+    undo.pop();
+    CHECK(stack.block->pos_ == (Point3{2, 2, 2}));
+    CHECK(stack.player->pos_ == (Point3{2, 2, 1}));
+
+    make_move(map, stack.player, {1,0,0}, undo);
+    CHECK(stack.player->pos_ == (Point3{3, 2, 1}));
+    CHECK(stack.block->pos_ == (Point3{2, 2, 1}));
+}
+
+// The player leaves the block's room, as if through a door, before that
+// room has had a fall step.  A move undone in another room mustn't make
+// the block's room forget that its block lost its support.
+static void leave_room_then_undo_elsewhere() {
+    GameObjectArray objs {};
+    UndoStack undo {objs, 20};
+    Stack stack {objs};
+    RoomMap* left_map = stack.room.map();
+    Room other {"other"};
+    make_room(other, objs);
+    RoomMap* other_map = other.map();
+    auto other_player_unique = std::make_unique<Player>(Point3{1, 1, 1}, RidingState::Free);
+    Player* other_player = other_player_unique.get();
+    other_map->create(std::move(other_player_unique), nullptr);
+    other_map->set_initial_state(false);
+
+    auto door_frame = std::make_unique<DeltaFrame>();
+    left_map->take_loud(stack.player, door_frame.get());
+    undo.push(std::move(door_frame));
+    CHECK(stack.block->pos_ == (Point3{2, 2, 2}));
+
+    make_move(other_map, other_player, {1,0,0}, undo);
+    CHECK(other_player->pos_ == (Point3{2, 1, 1}));
+    undo.pop();
+    other_map->reset_local_state();
+    CHECK(other_player->pos_ == (Point3{1, 1, 1}));
+
+    DeltaFrame delta_frame {};
+    MoveProcessor mp {nullptr, left_map, &delta_frame, true};
+    mp.try_fall_step();
+    CHECK(stack.block->pos_ == (Point3{2, 2, 1}));
+}
+
+int main() {
+    walk_away_after_undo();
+    leave_room_then_undo_elsewhere();
+    return failed_checks != 0;
+}
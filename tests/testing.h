@@ -0,0 +1,16 @@
+#ifndef TESTING_H
+#define TESTING_H
+
+#include <cstdio>
+
+// Each test program counts its own failed checks and returns nonzero if any failed
+static int failed_checks = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        ++failed_checks; \
+    } \
+} while (0)
+
+#endif // TESTING_H